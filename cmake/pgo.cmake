@@ -0,0 +1,111 @@
+# Profile guided optimisation of factory-simulation, run through the pgo target:
+#   1. WORK_DIR/base  plain Release -O3, the reference
+#   2. WORK_DIR/pgo   instrumented with -fprofile-generate
+#   3. training runs on it: several belt lengths, pair counts and seeds, both engines and batches
+#   4. WORK_DIR/pgo   rebuilt in place with -fprofile-use, gcda files are named after the build path
+#   5. the same workloads timed on base and pgo, best of 3, speedup reported
+#
+# cmake -DSOURCE_DIR=<repo> -DWORK_DIR=<dir> [-DGENERATOR=<generator>] -P pgo.cmake
+cmake_minimum_required(VERSION 3.10)
+
+if(NOT SOURCE_DIR OR NOT WORK_DIR)
+    message(FATAL_ERROR "pgo.cmake needs SOURCE_DIR and WORK_DIR")
+endif()
+if(NOT GENERATOR)
+    set(GENERATOR "Unix Makefiles")
+endif()
+
+set(PROFILE_DIR ${WORK_DIR}/profile)
+
+function(BuildVariant DIR FLAGS)
+    execute_process(COMMAND ${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${DIR} -G ${GENERATOR}
+                            -DCMAKE_BUILD_TYPE=Release -DRUN_PROFILE=OFF -DRUN_UNITTEST=OFF "-DCMAKE_CXX_FLAGS=${FLAGS}"
+                    RESULT_VARIABLE rc OUTPUT_QUIET)
+    if(rc)
+        message(FATAL_ERROR "configuring ${DIR} failed")
+    endif()
+    execute_process(COMMAND ${CMAKE_COMMAND} --build ${DIR} --target factory-simulation --clean-first
+                    RESULT_VARIABLE rc OUTPUT_QUIET)
+    if(rc)
+        message(FATAL_ERROR "building ${DIR} failed")
+    endif()
+endfunction()
+
+function(RunQuiet BINARY)
+    execute_process(COMMAND ${BINARY} ${ARGN} RESULT_VARIABLE rc OUTPUT_QUIET)
+    if(rc)
+        message(FATAL_ERROR "${BINARY} ${ARGN} failed")
+    endif()
+endfunction()
+
+# "0.946497" -> 946497, the workloads are long enough never to print an exponent
+function(ToMicroseconds SECONDS OUT)
+    string(REGEX MATCH "^([0-9]+)\\.?([0-9]*)$" match "${SECONDS}")
+    if(NOT match)
+        message(FATAL_ERROR "cannot read time ${SECONDS}")
+    endif()
+    set(whole ${CMAKE_MATCH_1})
+    set(fraction "${CMAKE_MATCH_2}000000")
+    string(SUBSTRING ${fraction} 0 6 fraction)
+    string(REGEX REPLACE "^0+([0-9])" "\\1" fraction ${fraction})
+    math(EXPR us "${whole} * 1000000 + ${fraction}")
+    set(${OUT} ${us} PARENT_SCOPE)
+endfunction()
+
+# best of 3, each run prints "... in <seconds> s"
+function(TimeWorkload BINARY OUT)
+    set(best 0)
+    foreach(i 1 2 3)
+        execute_process(COMMAND ${BINARY} ${ARGN} RESULT_VARIABLE rc OUTPUT_VARIABLE output)
+        if(rc OR NOT output MATCHES " in ([0-9.]+) s")
+            message(FATAL_ERROR "${BINARY} ${ARGN} failed")
+        endif()
+        ToMicroseconds(${CMAKE_MATCH_1} us)
+        if(best EQUAL 0 OR us LESS best)
+            set(best ${us})
+        endif()
+    endforeach()
+    set(${OUT} ${best} PARENT_SCOPE)
+endfunction()
+
+message(STATUS "pgo: reference build")
+BuildVariant(${WORK_DIR}/base "")
+
+message(STATUS "pgo: instrumented build")
+file(REMOVE_RECURSE ${PROFILE_DIR})
+BuildVariant(${WORK_DIR}/pgo "-fprofile-generate=${PROFILE_DIR} -fprofile-update=prefer-atomic")
+
+message(STATUS "pgo: training")
+set(TRAINEE ${WORK_DIR}/pgo/factory-simulation)
+foreach(seed 1 2 3)
+    foreach(slots 3 8 16 64 100)
+        RunQuiet(${TRAINEE} --sequential --slots ${slots} --seed ${seed} --ticks 20000)
+        RunQuiet(${TRAINEE} --slots ${slots} --seed ${seed} --ticks 300)
+    endforeach()
+    RunQuiet(${TRAINEE} --slots 20 --pairs 7 --seed ${seed} --ticks 300)
+    RunQuiet(${TRAINEE} --batch 20000 100 ${seed} 1)
+    RunQuiet(${TRAINEE} --batch-bitsliced 20000 100 ${seed} 1)
+endforeach()
+
+message(STATUS "pgo: optimised build")
+BuildVariant(${WORK_DIR}/pgo "-fprofile-use=${PROFILE_DIR} -fprofile-partial-training -Wno-missing-profile")
+
+set(WORKLOADS
+    "sequential batch|--batch 200000 100 11 1"
+    "bit-sliced batch|--batch-bitsliced 200000 100 11 1"
+    "sequential 64 slots|--sequential --slots 64 --ticks 200000 --seed 11"
+    "threaded 3 slots|--slots 3 --ticks 20000 --seed 11")
+foreach(workload ${WORKLOADS})
+    string(REGEX MATCH "^([^|]*)\\|(.*)$" match "${workload}")
+    set(name ${CMAKE_MATCH_1})
+    separate_arguments(parts UNIX_COMMAND "${CMAKE_MATCH_2}")
+    TimeWorkload(${WORK_DIR}/base/factory-simulation base ${parts})
+    TimeWorkload(${WORK_DIR}/pgo/factory-simulation pgo ${parts})
+    math(EXPR permille "${base} * 1000 / ${pgo}")
+    math(EXPR whole "${permille} / 1000")
+    math(EXPR fraction "${permille} % 1000 + 1000")
+    string(SUBSTRING ${fraction} 1 3 fraction)
+    message(STATUS "pgo: ${name}: -O3 ${base} us, pgo ${pgo} us, speedup ${whole}.${fraction}x")
+endforeach()
+
+message(STATUS "pgo: optimised binary is ${WORK_DIR}/pgo/factory-simulation")
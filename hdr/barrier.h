@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include <sys/resource.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "placement.h"
+
+// How threads released by a PhaseBarrier wait for the rest.
+enum class WAIT_POLICY : std::uint8_t {
+
+    SPIN_WAIT,          // never sleeps; yields every so often so an oversubscribed core still makes progress
+    SPIN_PARK_WAIT,     // spins as long as recent waits suggest is worth it, then sleeps on a futex; parks at once with more threads than CPUs
+    PARK_WAIT           // sleeps on a futex right away, one context switch per wait
+};
+
+// Context switches of the calling thread so far, zero where the platform does not count them per thread.
+struct ContextSwitches {
+
+    std::uint64_t voluntary{0};     // the thread slept, a futex wait or a yield that gave the core away
+    std::uint64_t involuntary{0};   // the scheduler preempted it
+
+    static ContextSwitches OfThisThread() noexcept{
+
+        ContextSwitches ret;
+#ifdef RUSAGE_THREAD
+        rusage usage{};
+        if (getrusage(RUSAGE_THREAD, &usage) == 0){
+            ret.voluntary = usage.ru_nvcsw;
+            ret.involuntary = usage.ru_nivcsw;
+        }
+#endif
+        return ret;
+    }
+
+    ContextSwitches& operator+=(const ContextSwitches& other) noexcept{
+        voluntary += other.voluntary;
+        involuntary += other.involuntary;
+        return *this;
+    }
+
+    ContextSwitches operator-(const ContextSwitches& since) const noexcept{
+        return ContextSwitches{voluntary - since.voluntary, involuntary - since.involuntary};
+    }
+};
+
+/*
+ * A 32 bit word threads wait on until it reaches a value they need, as WAIT_POLICY says. Only the
+ * owner stores to it; a store makes the wake syscall only when somebody is parked on the word.
+ * The word has a cache line of its own.
+*/
+class alignas(64) WaitWord {
+
+public:
+    // spinning longer than this costs more than a futex sleep and wake
+    static constexpr std::uint32_t MAX_SPIN_NS = 20000;
+    static constexpr std::uint32_t MIN_SPIN_NS = 500;
+
+    WaitWord() = default;
+    WaitWord(const WaitWord&) = delete;
+    WaitWord& operator=(const WaitWord&) = delete;
+
+    std::uint32_t Load() const noexcept { return m_Value.load(std::memory_order_acquire); }
+
+    void Store(const std::uint32_t value) noexcept{
+
+        // seq_cst pairs with Park: either the sleeper is counted here or it sees the new value
+        m_Value.store(value, std::memory_order_seq_cst);
+        if (m_Sleepers.load(std::memory_order_seq_cst) > 0)
+            Wake();
+    }
+
+    // returns once isDone(value) holds, every store after that is visible
+    template<class IsDone>
+    void WaitUntil(IsDone&& isDone, const WAIT_POLICY policy){
+
+        switch (policy){
+        case WAIT_POLICY::SPIN_WAIT:
+            for (unsigned i = 1; !isDone(Load()); ++i){
+                Pause();
+                if (i % SPIN_CHECK_INTERVAL == 0)
+                    std::this_thread::yield();
+            }
+            return;
+        case WAIT_POLICY::SPIN_PARK_WAIT:
+            SpinThenPark(isDone);
+            return;
+        case WAIT_POLICY::PARK_WAIT:
+            Park(isDone);
+            return;
+        }
+    }
+
+    // how long SPIN_PARK_WAIT currently spins before it parks, in ns
+    std::uint32_t getSpinBudget() const noexcept { return m_SpinBudgetNs.load(std::memory_order_relaxed); }
+
+    /*
+     * SPIN_PARK_WAIT when every thread can have a CPU of its own, PARK_WAIT otherwise: a spinner on a
+     * shared CPU only holds up the thread it waits for. isSharingCpus says a placement pins two of
+     * the threads to one CPU, however many CPUs there are.
+    */
+    static WAIT_POLICY Effective(const WAIT_POLICY policy, const std::size_t noOfThreads, const bool isSharingCpus = false){
+        return policy == WAIT_POLICY::SPIN_PARK_WAIT && (isSharingCpus || noOfThreads > CpuPlacement::getAvailableConcurrency()) ?
+               WAIT_POLICY::PARK_WAIT : policy;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    // spin iterations between two looks at the clock, or two yields
+    static constexpr unsigned SPIN_CHECK_INTERVAL = 64;
+
+    /*
+     * Spins up to a budget learnt from recent waits, then parks. A wait that ends while spinning pulls
+     * the budget towards twice its length, one that had to park halves it, bounded by MIN_SPIN_NS and
+     * MAX_SPIN_NS.
+    */
+    template<class IsDone>
+    void SpinThenPark(IsDone& isDone){
+
+        const Clock::time_point start = Clock::now();
+        const std::uint32_t budget = m_SpinBudgetNs.load(std::memory_order_relaxed);
+        for (unsigned i = 1; !isDone(Load()); ++i){
+            Pause();
+            if (i % SPIN_CHECK_INTERVAL == 0 && ElapsedNs(start) >= budget){
+                Park(isDone);
+                m_SpinBudgetNs.store(std::max(budget / 2, MIN_SPIN_NS), std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        // racy updates are fine, the budget only steers how long to spin
+        const std::int64_t target = static_cast<std::int64_t>(std::min<std::uint64_t>(2 * ElapsedNs(start), MAX_SPIN_NS));
+        const std::int64_t learnt = budget + (target - static_cast<std::int64_t>(budget)) / 8;
+        m_SpinBudgetNs.store(std::max(static_cast<std::uint32_t>(learnt), MIN_SPIN_NS), std::memory_order_relaxed);
+    }
+
+    template<class IsDone>
+    void Park(IsDone& isDone){
+
+        m_Sleepers.fetch_add(1, std::memory_order_seq_cst);
+        while (true){
+            const std::uint32_t value = m_Value.load(std::memory_order_seq_cst);
+            if (isDone(value))
+                break;
+#ifdef __linux__
+            // returns at once if the word changed in between
+            syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&m_Value), FUTEX_WAIT_PRIVATE, value, nullptr, nullptr, 0);
+#else
+            std::this_thread::yield();
+#endif
+        }
+        m_Sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void Wake(){
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&m_Value), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+    }
+
+    static inline void Pause() noexcept{
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    }
+
+    static std::uint64_t ElapsedNs(const Clock::time_point start) noexcept{
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t) && std::atomic<std::uint32_t>::is_always_lock_free,
+                  "the futex waits on the word itself");
+
+    std::atomic<std::uint32_t> m_Value{0};
+    std::atomic<std::uint32_t> m_Sleepers{0};
+    std::atomic<std::uint32_t> m_SpinBudgetNs{MIN_SPIN_NS};
+};
+
+/*
+ * Reusable phase barrier. Same contract as C++20 std::barrier, kept here since we build with C++17.
+ * Last thread to arrive runs the completion step before anyone is released, so the completion
+ * step is ordered after every thread's work of the previous phase and before any of the next.
+ * Nothing is allocated after construction; the same barrier is reused on every tick.
+ *
+ * Arrival is a single atomic decrement, release a store of the next phase to the WaitWord the
+ * others wait on.
+*/
+template<class CompletionFunction>
+class PhaseBarrier {
+
+public:
+    PhaseBarrier(const std::ptrdiff_t expected, CompletionFunction completion, const WAIT_POLICY policy = WAIT_POLICY::SPIN_PARK_WAIT,
+                 const bool isSharingCpus = false)
+        :m_Pending(expected),
+         m_Expected(expected),
+         m_Completion(std::move(completion)),
+         m_Policy(policy),
+         m_EffectivePolicy(WaitWord::Effective(policy, expected, isSharingCpus))
+    {}
+
+    PhaseBarrier(const PhaseBarrier&) = delete;
+    PhaseBarrier& operator=(const PhaseBarrier&) = delete;
+
+    void ArriveAndWait(){
+
+        const std::uint32_t phase = m_Phase.Load();
+        if (!Arrive(phase))
+            m_Phase.WaitUntil([phase](const std::uint32_t current){ return current != phase; }, m_EffectivePolicy);
+    }
+
+    // only while no thread is waiting on the barrier, see WaitWord::Effective for isSharingCpus
+    void SetWaitPolicy(const WAIT_POLICY policy, const bool isSharingCpus = false){
+        m_Policy = policy;
+        m_EffectivePolicy = WaitWord::Effective(policy, m_Expected, isSharingCpus);
+    }
+
+    WAIT_POLICY getWaitPolicy() const noexcept { return m_Policy; }
+
+    std::uint32_t getSpinBudget() const noexcept { return m_Phase.getSpinBudget(); }
+
+private:
+    // Returns true if this arrival completed the phase.
+    bool Arrive(const std::uint32_t phase){
+
+        // acq_rel: the last to arrive sees every other thread's work of this phase
+        if (m_Pending.fetch_sub(1, std::memory_order_acq_rel) > 1)
+            return false;
+
+        m_Completion();
+        m_Pending.store(m_Expected, std::memory_order_relaxed);
+        m_Phase.Store(phase + 1);
+        return true;
+    }
+
+    // the word everybody waits on has a line of its own, arrivals hammer m_Pending
+    WaitWord m_Phase;
+    alignas(64) std::atomic<std::ptrdiff_t> m_Pending;
+    const std::ptrdiff_t m_Expected;
+    CompletionFunction m_Completion;
+    WAIT_POLICY m_Policy;
+    WAIT_POLICY m_EffectivePolicy;
+};
@@ -10,41 +10,86 @@ enum /*class*/ COMPONENT : uint8_t {
    COMPONENT_Q = COMPONENT_P
 };
 
-// must be lock free always
+/*
+ * Packed into two bytes so std::atomic<SlotData> is a plain load/store/CAS on every target.
+ * bit n holds COMPONENT n (so P fits too), top bit is the isUpdated flag.
+ * generation counts writes to the slot, so a compare-exchange against a copy read earlier
+ * fails once anyone else wrote the slot in between, even if they left the same bits.
+*/
 struct SlotData {
 
     // No role for Component so not doing object visualization
-    std::bitset<4> component;
-    bool isUpdated{false};
+    std::uint8_t bits{0};
+    std::uint8_t generation{0};
 
-    inline bool testIsEmpty() {
-        return !component.any();
+    static constexpr std::uint8_t COMPONENT_MASK = 0x1F;
+    static constexpr std::uint8_t UPDATED_BIT = 0x80;
+
+    inline constexpr bool testIsEmpty() const {
+        return !(bits & COMPONENT_MASK);
     }
 
-    inline void SetComponentData(uint8_t c){
-        component.set(c);
+    inline constexpr void SetComponentData(uint8_t c){
+        bits |= static_cast<std::uint8_t>(1u << c);
     }
 
-    inline bool AnyComponent(){
-        return component.test(COMPONENT::COMPONENT_A) || component.test(COMPONENT::COMPONENT_B) || component.test(COMPONENT::COMPONENT_C);
+    inline constexpr bool AnyComponent() const {
+        return bits & ((1u << COMPONENT::COMPONENT_A) | (1u << COMPONENT::COMPONENT_B) | (1u << COMPONENT::COMPONENT_C));
     }
 
     template<std::uint8_t C>
-    inline bool testComponent() {
-        return component.test(C);
+    inline constexpr bool testComponent() const {
+        static_assert(C < 5, "only 5 component bits are packed");
+        return bits & (1u << C);
     }
 
     template<std::uint8_t C>
-    inline void ClearComponent(){
-        component.reset(C);
+    inline constexpr void ClearComponent(){
+        static_assert(C < 5, "only 5 component bits are packed");
+        bits &= static_cast<std::uint8_t>(~(1u << C));
     }
 
     template<std::uint8_t C>
-    inline void SetComponent(){
-        component.set(C);
+    inline constexpr void SetComponent(){
+        static_assert(C < 5, "only 5 component bits are packed");
+        bits |= static_cast<std::uint8_t>(1u << C);
+    }
+
+    inline constexpr bool testIsUpdated() const {
+        return bits & UPDATED_BIT;
+    }
+
+    inline constexpr void SetUpdated(){
+        bits |= UPDATED_BIT;
+    }
+
+    // call on the new value of every write, previous being the value it replaces
+    inline constexpr void NextGeneration(const SlotData previous){
+        generation = static_cast<std::uint8_t>(previous.generation + 1);
     }
 };
 
+// must be lock free always
+static_assert(std::atomic<SlotData>::is_always_lock_free, "SlotData must fit a native atomic word");
+
+// belt length only known at run time, as std::dynamic_extent for spans
+inline constexpr std::size_t DYNAMIC_SLOTS = 0;
+
+// slot and pair index of belts that do not fit a byte, 64 bit with -DRUN_SLOT_INDEX_64=ON
+#ifdef RUN_SLOT_INDEX_64
+using WideSlotIndex = std::uint64_t;
+#else
+using WideSlotIndex = std::uint32_t;
+#endif
+
+/*
+ * How a belt stores its slot indices and counts. Fixed belts of up to 255 slots keep bytes, every
+ * other belt, those sized at run time included, WideSlotIndex. Arithmetic on indices is done in
+ * std::size_t whatever the stored type.
+*/
+template<std::size_t NO_OF_SLOTS>
+using SlotIndex = std::conditional_t<NO_OF_SLOTS != DYNAMIC_SLOTS && NO_OF_SLOTS <= 0xFF, std::uint8_t, WideSlotIndex>;
+
 /*
  * sttaic vector with slots aligned to cache line to ensure false sharing
 */
@@ -52,6 +97,13 @@ template<class T, std::size_t NO_OF_SLOTS>
 class ConveyorBelt {
 
 public:
+    explicit ConveyorBelt(std::size_t = NO_OF_SLOTS) {
+
+        for(std::size_t pos = 0; pos < NO_OF_SLOTS; ++pos) {
+            ::new (static_cast<void*>(&m_Slots[pos])) T();
+        }
+    }
+
     T& operator[](std::size_t pos) {
 
         return *std::launder(reinterpret_cast<T*>(&m_Slots[pos]));
@@ -67,4 +119,45 @@ public:
 private:
     static constexpr std::size_t hardware_constructive_interference_size = 64;
     std::aligned_storage_t<sizeof(T), hardware_constructive_interference_size> m_Slots[NO_OF_SLOTS]{0};
+
+public:
+    static constexpr std::size_t BYTES_PER_SLOT = sizeof(m_Slots[0]);
+};
+
+// same belt sized at construction
+template<class T>
+class ConveyorBelt<T, DYNAMIC_SLOTS> {
+
+public:
+    explicit ConveyorBelt(const std::size_t noOfSlots)
+        :m_NoOfSlots(noOfSlots),
+         m_Slots(new Storage[noOfSlots])
+    {
+
+        for(std::size_t pos = 0; pos < noOfSlots; ++pos) {
+            ::new (static_cast<void*>(&m_Slots[pos])) T();
+        }
+    }
+
+    T& operator[](std::size_t pos) {
+
+        return *std::launder(reinterpret_cast<T*>(&m_Slots[pos]));
+    }
+
+    ~ConveyorBelt() {
+
+        for(std::size_t pos = 0; pos < m_NoOfSlots; ++pos) {
+            std::destroy_at(std::launder(reinterpret_cast<T*>(&m_Slots[pos])));
+        }
+    }
+
+private:
+    static constexpr std::size_t hardware_constructive_interference_size = 64;
+    using Storage = std::aligned_storage_t<sizeof(T), hardware_constructive_interference_size>;
+
+    const std::size_t m_NoOfSlots;
+    std::unique_ptr<Storage[]> m_Slots;
+
+public:
+    static constexpr std::size_t BYTES_PER_SLOT = sizeof(Storage);
 };
@@ -0,0 +1,341 @@
+#pragma once
+
+#include <cstring>
+
+#include "production.h"
+
+/*
+ * Word types for the bit-sliced engine. Bit l of every plane belongs to factory (lane) l.
+ * The wide ones are GCC vector extensions so &, |, ^, ~ map onto SSE/AVX2/AVX-512 registers
+ * when the target has them and get split into narrower ops when it does not.
+*/
+using Lanes64 = std::uint64_t;
+typedef std::uint64_t Lanes256 __attribute__((vector_size(32)));
+typedef std::uint64_t Lanes512 __attribute__((vector_size(64)));
+
+template<class W>
+struct LaneTraits {
+
+    static constexpr std::size_t WORDS = sizeof(W) / sizeof(std::uint64_t);
+    static constexpr std::size_t LANES = WORDS * 64;
+
+    static W Ones() noexcept { return ~W{}; }
+
+    static bool Any(const W& w) noexcept{
+        std::uint64_t words[WORDS];
+        std::memcpy(words, &w, sizeof(W));
+        std::uint64_t acc = 0;
+        for (std::size_t i = 0; i < WORDS; ++i)
+            acc |= words[i];
+        return acc != 0;
+    }
+
+    static bool Test(const W& w, const std::size_t lane) noexcept{
+        std::uint64_t words[WORDS];
+        std::memcpy(words, &w, sizeof(W));
+        return (words[lane / 64] >> (lane % 64)) & 1u;
+    }
+
+    static void Set(W& w, const std::size_t lane) noexcept{
+        std::uint64_t words[WORDS];
+        std::memcpy(words, &w, sizeof(W));
+        words[lane / 64] |= std::uint64_t{1} << (lane % 64);
+        std::memcpy(&w, words, sizeof(W));
+    }
+};
+
+/*
+ * Vertical counter, plane k holds bit k of every lane's count. Adding a lane mask is a
+ * ripple carry that usually stops after a plane or two; a plane is added on overflow.
+*/
+template<class W>
+class LaneCounter {
+
+public:
+    void Add(W mask){
+
+        for (auto& plane : m_Planes){
+            const W carry = plane & mask;
+            plane ^= mask;
+            mask = carry;
+            if (!LaneTraits<W>::Any(mask))
+                return;
+        }
+        if (LaneTraits<W>::Any(mask))
+            m_Planes.push_back(mask);
+    }
+
+    std::size_t Get(const std::size_t lane) const noexcept{
+
+        std::size_t ret = 0;
+        for (std::size_t k = 0; k < m_Planes.size(); ++k){
+            ret |= static_cast<std::size_t>(LaneTraits<W>::Test(m_Planes[k], lane)) << k;
+        }
+        return ret;
+    }
+
+private:
+    std::vector<W> m_Planes;
+};
+
+/*
+ * Runs LANES independent factories in lockstep, one bit per factory in every plane. It models
+ * exactly what the sequential engine does: same index rotation, same exit accounting, workers of
+ * a pair stepped first then second, and every StateChart branch turned into AND/OR/ANDNOT masks.
+ * Worker state is one-hot (5 planes), timeout is a 3 bit counter (0..4) and the hand is A or B/C.
+*/
+template<class W, std::size_t NO_OF_SLOTS = Production::DEFAULT_NO_OF_SLOTS>
+class BitSlicedProduction {
+
+public:
+    static constexpr std::size_t LANES = LaneTraits<W>::LANES;
+    static constexpr std::size_t NO_OF_COMPONENT_BITS = 5;
+    static constexpr std::size_t NO_OF_RANDOM_PLANES = 16;
+    static constexpr std::size_t FEED_ENTRIES = Production::FEED_COMPONENTS.size();
+
+    explicit BitSlicedProduction(const std::uint64_t seed = std::random_device{}(),
+                                 const Production::FeedProbabilities& feedProbabilities = Production::DEFAULT_FEED_PROBABILITIES){
+
+        double sum = 0.0;
+        for (const double p : feedProbabilities){
+            if (!(p >= 0.0))
+                throw std::invalid_argument("BitSlicedProduction: negative probability");
+            sum += p;
+        }
+        if (!(sum > 0.0))
+            throw std::invalid_argument("BitSlicedProduction: probabilities sum to zero");
+
+        // cumulative thresholds in 16 bit fixed point, the last entry takes whatever is left
+        double cumulative = 0.0;
+        for (std::size_t e = 0; e + 1 < FEED_ENTRIES; ++e){
+            cumulative += feedProbabilities[e] / sum;
+            m_FeedThreshold[e] = static_cast<std::uint32_t>(std::min(cumulative, 1.0) * (1u << NO_OF_RANDOM_PLANES) + 0.5);
+        }
+
+        // xoshiro256** seeded through splitmix64 as its authors recommend
+        std::uint64_t x = seed;
+        for (auto& s : m_Rng){
+            x += 0x9E3779B97F4A7C15ull;
+            std::uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            s = z ^ (z >> 31);
+        }
+
+        for (auto& w : m_Workers){
+            w.fetch = LaneTraits<W>::Ones();
+        }
+    }
+
+    // Random feed with the given probabilities, each exact to within 2^-16.
+    void Start(const std::size_t runTime){
+
+#ifdef RUN_CATCH
+        Start(runTime, [](W (&component)[NO_OF_COMPONENT_BITS]){ component[COMPONENT::COMPONENT_A] = LaneTraits<W>::Ones(); });
+#else
+        Start(runTime, [this](W (&component)[NO_OF_COMPONENT_BITS]){ RandomFeed(component); });
+#endif
+    }
+
+    // componentFeeder(W (&component)[5]) sets, for every lane, the component bit fed on this tick.
+    template<class Feeder>
+    void Start(const std::size_t runTime, Feeder&& componentFeeder){
+
+        for (std::size_t i = 0; i < runTime; ++i){
+
+            W component[NO_OF_COMPONENT_BITS]{};
+            componentFeeder(component);
+            Feed(component);
+
+            // same ring as ProductionLine::getSlotOfPair
+            for (std::size_t pair = 0; pair < NO_OF_SLOTS; ++pair){
+                Slot& slot = m_Belt[m_Head + pair < NO_OF_SLOTS ? m_Head + pair : m_Head + pair - NO_OF_SLOTS];
+                Step(m_Workers[2 * pair], slot);
+                Step(m_Workers[2 * pair + 1], slot);
+            }
+        }
+    }
+
+    std::size_t getm_noOfProductsFormed(const std::size_t lane) const { return m_noOfProductsFormed.Get(lane); }
+    std::size_t getm_noOfComponentsUnHandled(const std::size_t lane) const { return m_noOfComponentsUnHandled.Get(lane); }
+    std::size_t getm_noOfEmptyFeed(const std::size_t lane) const { return m_noOfEmptyFeed.Get(lane); }
+
+    std::size_t getNoOfWorkersWithUnfinishedProducts(const std::size_t lane) const{
+
+        std::size_t ret = 0;
+        for (const auto& w : m_Workers){
+            const W unfinished = w.getBOrC | w.getA | ((w.decode | w.full) & (w.handA | w.handB));
+            ret += LaneTraits<W>::Test(unfinished, lane);
+        }
+        return ret;
+    }
+
+    /*
+     * Each lane draws a 16 bit number r spread over 16 planes and picks entry e of FEED_COMPONENTS
+     * when T(e - 1) <= r < T(e), T being the cumulative probabilities in 16 bit fixed point. The
+     * comparisons run MSB first over the planes, so the whole draw is a few hundred mask ops for all lanes.
+     * This is the feed of Start(runTime) outside the unit tests.
+    */
+    void RandomFeed(W (&component)[NO_OF_COMPONENT_BITS]){
+
+        W random[NO_OF_RANDOM_PLANES];
+        for (auto& plane : random){
+            std::uint64_t words[LaneTraits<W>::WORDS];
+            for (auto& word : words)
+                word = NextRandom();
+            std::memcpy(&plane, words, sizeof(W));
+        }
+
+        W below{};
+        for (std::size_t e = 0; e < FEED_ENTRIES; ++e){
+            const W belowNext = e + 1 < FEED_ENTRIES ? LessThan(random, m_FeedThreshold[e]) : LaneTraits<W>::Ones();
+            if (Production::FEED_COMPONENTS[e] != COMPONENT::EMPTY)
+                component[Production::FEED_COMPONENTS[e]] |= belowNext & ~below;
+            below = belowNext;
+        }
+    }
+
+private:
+    struct Slot {
+        W component[NO_OF_COMPONENT_BITS]{};
+        W updated{};
+    };
+
+    struct WorkerPlanes {
+        W fetch{}, getBOrC{}, getA{}, decode{}, full{};
+        W timeout[3]{};
+        W handA{}, handB{};
+    };
+
+    void Feed(const W (&component)[NO_OF_COMPONENT_BITS]){
+
+        // same as ProductionLine::Feed, the slot at the head leaves the belt and is reused
+        Slot& slot = m_Belt[m_Head];
+        const W any = slot.component[COMPONENT::COMPONENT_A] | slot.component[COMPONENT::COMPONENT_B] | slot.component[COMPONENT::COMPONENT_C];
+        m_noOfComponentsUnHandled.Add(any);
+        m_noOfProductsFormed.Add(~any & NonEmpty(slot));
+        m_Head = static_cast<SlotIndex<NO_OF_SLOTS>>(m_Head == 0 ? NO_OF_SLOTS - 1 : m_Head - 1);
+
+        for (std::size_t c = 0; c < NO_OF_COMPONENT_BITS; ++c){
+            slot.component[c] = component[c];
+        }
+        slot.updated = W{};
+        m_noOfEmptyFeed.Add(~NonEmpty(slot));
+    }
+
+    static W NonEmpty(const Slot& slot) noexcept{
+        W ret{};
+        for (const auto& c : slot.component)
+            ret |= c;
+        return ret;
+    }
+
+    // StateChart::Process followed by the commit of Worker::Step, for every lane at once.
+    static void Step(WorkerPlanes& w, Slot& slot) noexcept{
+
+        const W active = ~slot.updated;
+
+        // m_Timeout > 0 ? --m_Timeout, as a masked 3 bit decrement
+        W borrow = active & (w.timeout[0] | w.timeout[1] | w.timeout[2]);
+        for (auto& t : w.timeout){
+            const W next = borrow & ~t;
+            t ^= borrow;
+            borrow = next;
+        }
+        const W timedOut = ~(w.timeout[0] | w.timeout[1] | w.timeout[2]);
+
+        const W a = slot.component[COMPONENT::COMPONENT_A];
+        const W bOrC = slot.component[COMPONENT::COMPONENT_B] | slot.component[COMPONENT::COMPONENT_C];
+        const W empty = ~NonEmpty(slot);
+
+        // StateFetch
+        const W fetchA = active & w.fetch & a;
+        const W fetchBOrC = active & w.fetch & ~a & bOrC;
+        // StateGetBOrC, StateGetA
+        const W gotBOrC = active & w.getBOrC & bOrC;
+        const W gotA = active & w.getA & a;
+        // StateDecode. Neither branch marks the slot updated so the slot itself is never committed.
+        const W decodeDone = active & w.decode & timedOut & empty;
+        const W decodeTakeA = active & w.decode & timedOut & a;
+        const W decodeTakeBOrC = active & w.decode & timedOut & bOrC;
+        const W decodeFull = decodeTakeA | decodeTakeBOrC;
+        // StateFull
+        const W placed = active & w.full & empty;
+
+        const W toGetBOrC = fetchA | (placed & w.handA);
+        const W toGetA = fetchBOrC | (placed & ~w.handA & w.handB);
+        const W toDecode = gotBOrC | gotA;
+        const W toFetch = decodeDone | (placed & ~w.handA & ~w.handB);
+        const W left = fetchA | fetchBOrC | gotBOrC | gotA | decodeFull | decodeDone | placed;
+
+        w.fetch = (w.fetch & ~left) | toFetch;
+        w.getBOrC = (w.getBOrC & ~left) | toGetBOrC;
+        w.getA = (w.getA & ~left) | toGetA;
+        w.decode = (w.decode & ~left) | toDecode;
+        w.full = (w.full & ~left) | decodeFull;
+
+        // m_Timeout = 4 on the way into StateDecode
+        w.timeout[0] &= ~toDecode;
+        w.timeout[1] &= ~toDecode;
+        w.timeout[2] |= toDecode;
+
+        // B/C is tested after A in StateDecode so it wins when both are present
+        w.handA = (w.handA & ~decodeFull) | (decodeTakeA & ~decodeTakeBOrC);
+        w.handB = (w.handB & ~decodeFull) | decodeTakeBOrC;
+
+        // commit, only the lanes which marked the slot updated
+        const W clearA = fetchA | gotA;
+        const W clearBOrC = fetchBOrC | gotBOrC;
+        slot.component[COMPONENT::COMPONENT_A] &= ~clearA;
+        slot.component[COMPONENT::COMPONENT_B] &= ~clearBOrC;
+        slot.component[COMPONENT::COMPONENT_C] &= ~clearBOrC;
+        slot.component[COMPONENT::COMPONENT_P] |= placed;
+        slot.updated |= clearA | clearBOrC | placed;
+    }
+
+    std::uint64_t NextRandom() noexcept{
+
+        const std::uint64_t result = Rotl(m_Rng[1] * 5, 7) * 9;
+        const std::uint64_t t = m_Rng[1] << 17;
+        m_Rng[2] ^= m_Rng[0];
+        m_Rng[3] ^= m_Rng[1];
+        m_Rng[1] ^= m_Rng[2];
+        m_Rng[0] ^= m_Rng[3];
+        m_Rng[2] ^= t;
+        m_Rng[3] = Rotl(m_Rng[3], 45);
+        return result;
+    }
+
+    static std::uint64_t Rotl(const std::uint64_t x, const int k) noexcept{
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static W LessThan(const W (&random)[NO_OF_RANDOM_PLANES], const std::uint32_t threshold) noexcept{
+
+        // a cumulative probability of 1 rounds to 2^16, which no 16 bit number reaches
+        if (threshold >> NO_OF_RANDOM_PLANES)
+            return LaneTraits<W>::Ones();
+
+        W less{};
+        W equal = LaneTraits<W>::Ones();
+        for (std::size_t k = NO_OF_RANDOM_PLANES; k-- > 0;){
+            if ((threshold >> k) & 1u){
+                less |= equal & ~random[k];
+                equal &= random[k];
+            }else{
+                equal &= ~random[k];
+            }
+        }
+        return less;
+    }
+
+    std::array<Slot, NO_OF_SLOTS> m_Belt{};
+    std::array<WorkerPlanes, 2 * NO_OF_SLOTS> m_Workers{};
+    SlotIndex<NO_OF_SLOTS> m_Head{0};
+    std::uint64_t m_Rng[4];
+    std::array<std::uint32_t, FEED_ENTRIES - 1> m_FeedThreshold{};
+
+    LaneCounter<W> m_noOfProductsFormed;
+    LaneCounter<W> m_noOfComponentsUnHandled;
+    LaneCounter<W> m_noOfEmptyFeed;
+};
@@ -4,11 +4,11 @@
 #define CATCH_CONFIG_MAIN
 #include "../hdr/catch.hpp"
 
-std::unique_ptr<Production> Test_Function(std::size_t runTime)
+std::unique_ptr<Production> Test_Function(std::size_t runTime, const ENGINE engine = ENGINE::THREADED_ENGINE)
 {
     std::unique_ptr<Production> p = std::make_unique<Production>();
     try{
-        p->Start(runTime);
+        p->Start(runTime, engine);
     }catch(std::exception& ex){
         std::cout << "ex: " << ex.what() << std::endl;
     }
@@ -25,6 +25,7 @@ TEST_CASE("Validate Output")
     std::cout << "No. of products formed: " << p->getm_noOfProductsFormed() << std::endl;
     std::cout << "No. of components left unhandled: " << p->getm_noOfComponentsUnHandled() << std::endl;
 
+    // 7 of the 10 As left the belt, 6 workers took one each
     bool test = (6 == p->getNoOfWorkersWithUnfinishedProducts() &&
                  0 == p->getm_noOfEmptyFeed() &&
                  0 == p->getm_noOfProductsFormed() &&
@@ -32,3 +33,540 @@ TEST_CASE("Validate Output")
 
     REQUIRE(test == true);
 }
+
+TEST_CASE("Sequential engine matches threaded engine")
+{
+    for (const std::size_t runTime : {1, 2, 3, 10, 100}){
+        const auto& threaded = Test_Function(runTime, ENGINE::THREADED_ENGINE);
+        const auto& sequential = Test_Function(runTime, ENGINE::SEQUENTIAL_ENGINE);
+
+        REQUIRE(threaded->getNoOfWorkersWithUnfinishedProducts() == sequential->getNoOfWorkersWithUnfinishedProducts());
+        REQUIRE(threaded->getm_noOfEmptyFeed() == sequential->getm_noOfEmptyFeed());
+        REQUIRE(threaded->getm_noOfProductsFormed() == sequential->getm_noOfProductsFormed());
+        REQUIRE(threaded->getm_noOfComponentsUnHandled() == sequential->getm_noOfComponentsUnHandled());
+    }
+}
+
+TEST_CASE("Contention counters account for every processed slot")
+{
+    for (const std::size_t noOfSlots : {3, 16}){
+        Production threaded(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots);
+        Production sequential(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots);
+        threaded.Start(100, ENGINE::THREADED_ENGINE);
+        sequential.Start(100, ENGINE::SEQUENTIAL_ENGINE);
+
+        const WorkerStats t = threaded.getContentionStats();
+        const WorkerStats s = sequential.getContentionStats();
+        REQUIRE(t.rollbacks == t.claimFailures);
+        REQUIRE(s.rollbacks == 0);
+        REQUIRE(s.cyclesWasted == 0);
+        // whichever worker of a pair wins, the pair commits the same slots
+        REQUIRE(t.commits == s.commits);
+        REQUIRE(s.skippedUpdated > 0);
+
+        WorkerStats sum;
+        for (std::size_t station = 0; station < threaded.getNoOfWorkers(); ++station)
+            sum.Merge(threaded.getWorkerStats(station));
+        REQUIRE(sum.commits == t.commits);
+        REQUIRE(sum.rollbacks == t.rollbacks);
+    }
+}
+
+TEST_CASE("Slot claims fail once the slot was written, even with the same bits")
+{
+    std::atomic<SlotData> slot;
+    SlotData fed;
+    fed.SetComponentData(COMPONENT::COMPONENT_A);
+    fed.NextGeneration(slot.load());
+    slot.store(fed);
+
+    // both workers of a pair read the slot, the first claim wins
+    const SlotData s_read = slot.load();
+    SlotData first = s_read, second = s_read;
+    first.SetUpdated();
+    first.NextGeneration(s_read);
+    second.SetUpdated();
+    second.NextGeneration(s_read);
+
+    SlotData expected = s_read;
+    REQUIRE(slot.compare_exchange_strong(expected, first));
+    expected = s_read;
+    REQUIRE_FALSE(slot.compare_exchange_strong(expected, second));
+
+    // a write restoring the bits read earlier still moves the generation on
+    SlotData restored = s_read;
+    restored.NextGeneration(slot.load());
+    slot.store(restored);
+    expected = s_read;
+    REQUIRE(restored.bits == s_read.bits);
+    REQUIRE_FALSE(slot.compare_exchange_strong(expected, second));
+}
+
+TEST_CASE("Merged running stats match a single pass")
+{
+    RunningStats all, first, second;
+    for (int i = 0; i < 1000; ++i){
+        const double x = (i * 7919) % 101;
+        all.Add(x);
+        (i < 300 ? first : second).Add(x);
+    }
+    first.Merge(second);
+
+    REQUIRE(first.getCount() == all.getCount());
+    REQUIRE(std::abs(first.getMean() - all.getMean()) < 1e-9);
+    REQUIRE(std::abs(first.getVariance() - all.getVariance()) < 1e-9);
+}
+
+TEST_CASE("Monte Carlo batch covers every run")
+{
+    MonteCarlo mc(3);
+    for (const std::size_t noOfRuns : {1, 100, 1000}){
+        const BatchResult result = mc.Run(noOfRuns, 10, 42);
+        const auto& p = Test_Function(10, ENGINE::SEQUENTIAL_ENGINE);
+
+        // feeder is fixed under RUN_CATCH so every run is identical
+        REQUIRE(result.productsFormed.getCount() == noOfRuns);
+        REQUIRE(result.componentsUnHandled.getMean() == p->getm_noOfComponentsUnHandled());
+        REQUIRE(result.workersWithUnfinishedProducts.getMean() == p->getNoOfWorkersWithUnfinishedProducts());
+        REQUIRE(result.componentsUnHandled.getStdDev() == 0.0);
+
+        // bit-sliced chunks are a whole production wide, sequential ones a fraction of the batch
+        REQUIRE(mc.Run(noOfRuns, 10, 42, BATCH_ENGINE::BITSLICED_BATCH).productsFormed.getCount() == noOfRuns);
+    }
+}
+
+// random feeds only on the sequential engine, which worker of a threaded pair wins a slot is up to the scheduler
+template<class Line>
+std::array<std::size_t, 4> Test_RunLayout(Line& line, const std::size_t runTime, const ENGINE engine, const bool isRandomFeed)
+{
+    if (isRandomFeed){
+        std::mt19937 gen(static_cast<unsigned>(line.getNoOfSlots() * 131 + line.getNoOfPairs()));
+        std::uniform_int_distribution<> distrib(0, Production::FEED_COMPONENTS.size() - 1);
+        line.Start(runTime, engine, [&gen, &distrib](){
+            SlotData data;
+            const std::uint8_t component = Production::FEED_COMPONENTS[distrib(gen)];
+            if (component != COMPONENT::EMPTY)
+                data.SetComponentData(component);
+            return data;
+        });
+    }else{
+        line.Start(runTime, engine);
+    }
+
+    return {line.getNoOfWorkersWithUnfinishedProducts(), line.getm_noOfEmptyFeed(),
+            line.getm_noOfProductsFormed(), line.getm_noOfComponentsUnHandled()};
+}
+
+TEST_CASE("Runtime belt layouts match their fixed size instantiation and the threaded engine")
+{
+    for (const std::size_t noOfSlots : Production::FAST_PATH_SLOTS){
+        Production fast(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots);
+        ProductionLine<DYNAMIC_SLOTS> dynamic(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots, noOfSlots);
+        REQUIRE(fast.getIsFastPath());
+        REQUIRE(Test_RunLayout(fast, 200, ENGINE::SEQUENTIAL_ENGINE, true) == Test_RunLayout(dynamic, 200, ENGINE::SEQUENTIAL_ENGINE, true));
+    }
+
+    for (const auto& [noOfSlots, noOfPairs] : {std::pair<std::size_t, std::size_t>{1, 1}, {5, 2}, {8, 8}, {20, 7}, {127, 127}, {300, 100}}){
+        Production threaded(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots, noOfPairs);
+        Production sequential(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots, noOfPairs);
+        REQUIRE(threaded.getNoOfWorkers() == 2 * noOfPairs);
+        REQUIRE(Test_RunLayout(threaded, 50, ENGINE::THREADED_ENGINE, false) == Test_RunLayout(sequential, 50, ENGINE::SEQUENTIAL_ENGINE, false));
+    }
+
+    REQUIRE_THROWS_AS(Production(1, Production::DEFAULT_FEED_PROBABILITIES, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(Production(1, Production::DEFAULT_FEED_PROBABILITIES, Production::MAX_NO_OF_SLOTS + 1), std::invalid_argument);
+    REQUIRE_THROWS_AS(Production(1, Production::DEFAULT_FEED_PROBABILITIES, 4, 5), std::invalid_argument);
+}
+
+TEST_CASE("Partitioned and systolic engines match the sequential engine for any segment count")
+{
+    for (const auto& [noOfSlots, noOfPairs] : {std::pair<std::size_t, std::size_t>{1, 1}, {3, 3}, {20, 7}, {64, 64}, {127, 127}}){
+        Production sequential(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots, noOfPairs);
+        Test_RunLayout(sequential, 100, ENGINE::SEQUENTIAL_ENGINE, true);
+        const auto expected = Test_RunLayout(sequential, 100, ENGINE::SEQUENTIAL_ENGINE, true);
+
+        for (const ENGINE engine : {ENGINE::PARTITIONED_ENGINE, ENGINE::SYSTOLIC_ENGINE}){
+            for (const std::size_t noOfSegments : {1, 2, 3, 8, 200}){
+                Production segmented(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots, noOfPairs);
+                segmented.SetNoOfSegments(noOfSegments);
+                REQUIRE(segmented.getNoOfSegments() == std::min(noOfSegments, noOfPairs));
+
+                // twice, a second Start carries on from the first
+                Test_RunLayout(segmented, 100, engine, true);
+                REQUIRE(Test_RunLayout(segmented, 100, engine, true) == expected);
+            }
+        }
+    }
+}
+
+TEST_CASE("Every slot leaving the belt is accounted once")
+{
+    // workers leave products alone, so every feed after the first lap pushes one off the belt
+    const auto productFeeder = [](){
+        SlotData data;
+        data.SetComponentData(COMPONENT::COMPONENT_P);
+        return data;
+    };
+    for (const auto& [noOfSlots, noOfPairs] : {std::pair<std::size_t, std::size_t>{1, 1}, {3, 3}, {20, 7}, {127, 127}, {300, 100}}){
+        for (const ENGINE engine : {ENGINE::SEQUENTIAL_ENGINE, ENGINE::THREADED_ENGINE, ENGINE::PARTITIONED_ENGINE,
+                                    ENGINE::SYSTOLIC_ENGINE, ENGINE::TEMPORAL_ENGINE}){
+            Production p(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots, noOfPairs);
+            p.SetNoOfSegments(3);
+            p.SetTemporalBlock(5, 4);
+            p.Start(2 * noOfSlots + 3, engine, productFeeder);
+            REQUIRE(p.getm_noOfProductsFormed() == noOfSlots + 3);
+            REQUIRE(p.getm_noOfComponentsUnHandled() == 0);
+        }
+    }
+}
+
+TEST_CASE("Belts longer than a byte indexes run every engine alike")
+{
+    static_assert(std::is_same_v<SlotIndex<64>, std::uint8_t> && std::is_same_v<SlotIndex<255>, std::uint8_t>);
+    static_assert(std::is_same_v<SlotIndex<256>, WideSlotIndex> && std::is_same_v<SlotIndex<DYNAMIC_SLOTS>, WideSlotIndex>);
+
+    // past 2^16 too, so neither a byte nor a short could index it
+    constexpr std::size_t noOfSlots = (1 << 16) + 3;
+    Production sequential(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots);
+    REQUIRE(sequential.getNoOfSlots() == noOfSlots);
+    const auto expected = Test_RunLayout(sequential, 300, ENGINE::SEQUENTIAL_ENGINE, true);
+
+    for (const ENGINE engine : {ENGINE::PARTITIONED_ENGINE, ENGINE::SYSTOLIC_ENGINE, ENGINE::TEMPORAL_ENGINE}){
+        Production p(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots);
+        p.SetNoOfSegments(3);
+        REQUIRE(Test_RunLayout(p, 300, engine, true) == expected);
+    }
+}
+
+TEST_CASE("Temporal blocking matches the sequential engine for any block and tile")
+{
+    for (const auto& [noOfSlots, noOfPairs] : {std::pair<std::size_t, std::size_t>{1, 1}, {3, 3}, {20, 7}, {64, 64}, {127, 127}}){
+        Production sequential(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots, noOfPairs);
+        Test_RunLayout(sequential, 100, ENGINE::SEQUENTIAL_ENGINE, true);
+        const auto expected = Test_RunLayout(sequential, 100, ENGINE::SEQUENTIAL_ENGINE, true);
+
+        for (const std::size_t ticksPerBlock : {1, 2, 3, 8, 200}){
+            for (const std::size_t slotsPerTile : {1, 5, 0}){
+                Production temporal(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots, noOfPairs);
+                temporal.SetTemporalBlock(ticksPerBlock, slotsPerTile);
+                REQUIRE(temporal.getTicksPerBlock() == ticksPerBlock);
+
+                // twice, blocks do not divide the run and the second Start carries on from the first
+                Test_RunLayout(temporal, 100, ENGINE::TEMPORAL_ENGINE, true);
+                REQUIRE(Test_RunLayout(temporal, 100, ENGINE::TEMPORAL_ENGINE, true) == expected);
+            }
+        }
+    }
+    // two workers a slot: a tile and getBytesPerSlot count the same bytes of a belt position
+    const Production line;
+    REQUIRE(line.getSlotsPerTile() == std::max<std::size_t>(1, Production::TEMPORAL_TILE_BYTES / static_cast<std::size_t>(line.getBytesPerSlot())));
+}
+
+TEST_CASE("Every wait policy runs the same ticks")
+{
+    for (const std::size_t noOfSlots : {3, 16}){
+        Production sequential(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots);
+        const auto expected = Test_RunLayout(sequential, 50, ENGINE::SEQUENTIAL_ENGINE, false);
+
+        for (const WAIT_POLICY policy : {WAIT_POLICY::SPIN_WAIT, WAIT_POLICY::SPIN_PARK_WAIT, WAIT_POLICY::PARK_WAIT}){
+            Production p(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots);
+            p.SetWaitPolicy(policy);
+            REQUIRE(p.getWaitPolicy() == policy);
+            REQUIRE(Test_RunLayout(p, 50, ENGINE::THREADED_ENGINE, false) == expected);
+#ifdef RUSAGE_THREAD
+            // every tick somebody waits for the slowest thread, parked that is a sleep
+            if (policy == WAIT_POLICY::PARK_WAIT){
+                REQUIRE(p.getContextSwitches().voluntary > 0);
+                // counted per Start, a sequential run switches no engine thread
+                p.Start(10, ENGINE::SEQUENTIAL_ENGINE);
+                REQUIRE(p.getContextSwitches().voluntary == 0);
+            }
+#endif
+        }
+    }
+}
+
+TEST_CASE("Pinned runs match unpinned ones and hand the caller its CPUs back")
+{
+    REQUIRE(CpuPlacement::ParseCpuList("0-3,8,10-11") == std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+    REQUIRE(CpuPlacement::ParseCpuList("").empty());
+    REQUIRE(CpuPlacement::getAvailableConcurrency() >= 1);
+    REQUIRE(CpuPlacement::getIsSharingCpus({0, 1, 0}));
+    REQUIRE(!CpuPlacement::getIsSharingCpus({CpuPlacement::NOT_PINNED, 1, CpuPlacement::NOT_PINNED}));
+    REQUIRE(WaitWord::Effective(WAIT_POLICY::SPIN_PARK_WAIT, 1, true) == WAIT_POLICY::PARK_WAIT);
+    REQUIRE(WaitWord::Effective(WAIT_POLICY::SPIN_WAIT, 1, true) == WAIT_POLICY::SPIN_WAIT);
+
+    // every pair placed, pairs sharing a line of worker state never split over nodes
+    const std::vector<std::vector<int>> nodes = CpuPlacement::getAllowedCpusByNode();
+    const CpuPlacement compact = CpuPlacement::Compact(100, Production::PAIRS_PER_STATE_LINE);
+    const auto nodeOf = [&nodes](const int cpu){
+        return std::find_if(nodes.begin(), nodes.end(), [cpu](const std::vector<int>& cpus){
+            return std::find(cpus.begin(), cpus.end(), cpu) != cpus.end();
+        }) - nodes.begin();
+    };
+    for (std::size_t pair = 0; pair < 100 && !nodes.empty(); ++pair){
+        REQUIRE(nodeOf(compact.getPairCpu(pair)) < static_cast<std::ptrdiff_t>(nodes.size()));
+        REQUIRE(nodeOf(compact.getPairCpu(pair)) == nodeOf(compact.getPairCpu(pair / Production::PAIRS_PER_STATE_LINE * Production::PAIRS_PER_STATE_LINE)));
+    }
+
+    const std::vector<int> callerCpus = CpuPlacement::getAllowedCpus();
+    // a thread left NOT_PINNED gets every CPU back, even one started by a pinned thread
+    if (!callerCpus.empty()){
+        const ScopedThreadPlacement producer("fs-test", callerCpus.back());
+        REQUIRE(std::async(std::launch::async, [](){
+            CpuPlacement::ApplyToThisThread("fs-test-worker", CpuPlacement::NOT_PINNED);
+            return CpuPlacement::getAllowedCpus();
+        }).get() == callerCpus);
+    }
+    for (const std::size_t noOfSlots : {3, 16}){
+        Production unpinned(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots);
+        Production pinned(1, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots);
+        pinned.SetCompactPlacement();
+        REQUIRE(pinned.getPlacement().getIsPinned() == !callerCpus.empty());
+
+        REQUIRE(Test_RunLayout(unpinned, 50, ENGINE::THREADED_ENGINE, false) == Test_RunLayout(pinned, 50, ENGINE::THREADED_ENGINE, false));
+        REQUIRE(CpuPlacement::getAllowedCpus() == callerCpus);
+    }
+}
+
+template<class W>
+void Test_BitSlicedMatchesSequential(const std::size_t runTime)
+{
+    using Traits = LaneTraits<W>;
+    std::vector<std::vector<std::uint8_t>> feeds(Traits::LANES);
+    for (std::size_t lane = 0; lane < Traits::LANES; ++lane){
+        std::mt19937 gen(lane);
+        std::uniform_int_distribution<> distrib(0, Production::FEED_COMPONENTS.size() - 1);
+        for (std::size_t i = 0; i < runTime; ++i)
+            feeds[lane].push_back(Production::FEED_COMPONENTS[distrib(gen)]);
+    }
+
+    BitSlicedProduction<W> sliced;
+    std::size_t tick = 0;
+    sliced.Start(runTime, [&feeds, &tick](W (&component)[5]){
+        for (std::size_t lane = 0; lane < Traits::LANES; ++lane){
+            if (feeds[lane][tick] != COMPONENT::EMPTY)
+                Traits::Set(component[feeds[lane][tick]], lane);
+        }
+        ++tick;
+    });
+
+    for (std::size_t lane = 0; lane < Traits::LANES; ++lane){
+        Production p;
+        std::size_t i = 0;
+        p.Start(runTime, ENGINE::SEQUENTIAL_ENGINE, [&feeds, &i, lane](){
+            SlotData data;
+            if (feeds[lane][i] != COMPONENT::EMPTY)
+                data.SetComponentData(feeds[lane][i]);
+            ++i;
+            return data;
+        });
+
+        REQUIRE(sliced.getNoOfWorkersWithUnfinishedProducts(lane) == p.getNoOfWorkersWithUnfinishedProducts());
+        REQUIRE(sliced.getm_noOfEmptyFeed(lane) == p.getm_noOfEmptyFeed());
+        REQUIRE(sliced.getm_noOfProductsFormed(lane) == p.getm_noOfProductsFormed());
+        REQUIRE(sliced.getm_noOfComponentsUnHandled(lane) == p.getm_noOfComponentsUnHandled());
+    }
+}
+
+TEST_CASE("Bit-sliced lanes match the sequential engine")
+{
+    Test_BitSlicedMatchesSequential<Lanes64>(100);
+    Test_BitSlicedMatchesSequential<Lanes256>(100);
+    Test_BitSlicedMatchesSequential<Lanes512>(7);
+}
+
+TEST_CASE("Transition table matches the reference state chart for every input")
+{
+    WorkerStore<1> store;
+    for (std::uint8_t state = STATE_FETCH; state <= STATE_FULL; ++state){
+        for (std::uint8_t timeout = 0; timeout <= 4; ++timeout){
+            for (unsigned bits = 0; bits < 256; ++bits){
+                for (std::uint8_t hand = 0; hand < 4; ++hand){
+                    STATE refState = static_cast<STATE>(state);
+                    std::uint8_t refTimeout = timeout;
+                    COMPONENT refHand = static_cast<COMPONENT>(hand);
+                    SlotData refSlot{static_cast<std::uint8_t>(bits)};
+                    ReferenceTransition(refState, refTimeout, refHand, refSlot);
+
+                    store.currState[0] = static_cast<STATE>(state);
+                    store.timeout[0] = timeout;
+                    store.componentInHand[0] = static_cast<COMPONENT>(hand);
+                    SlotData slot{static_cast<std::uint8_t>(bits)};
+                    StateChart<1> workFlow(store, 0);
+                    workFlow.Process(slot);
+
+                    REQUIRE(store.currState[0] == refState);
+                    REQUIRE(store.prevState[0] == state);
+                    REQUIRE(store.timeout[0] == refTimeout);
+                    REQUIRE(store.componentInHand[0] == refHand);
+                    REQUIRE(slot.bits == refSlot.bits);
+                }
+            }
+        }
+    }
+}
+
+void Test_FeedFrequencies(const Production::FeedProbabilities& probabilities)
+{
+    const AliasTable<Production::FEED_COMPONENTS.size()> table(probabilities);
+    BulkFeeder<Production::FEED_COMPONENTS.size()> whole(Production::FEED_COMPONENTS, table, 1234);
+    BulkFeeder<Production::FEED_COMPONENTS.size(), 64> chunked(Production::FEED_COMPONENTS, table, 1234, 7);
+
+    constexpr std::size_t DRAWS = 1000000;
+    std::array<std::size_t, 256> counts{};
+    for (std::size_t i = 0; i < DRAWS; ++i){
+        const SlotData data = whole();
+        if (data.bits != chunked().bits)
+            FAIL("feed sequence depends on buffer chunking");
+        ++counts[data.bits];
+    }
+
+    double sum = 0.0;
+    for (const double p : probabilities)
+        sum += p;
+
+    std::size_t seen = 0;
+    for (std::size_t e = 0; e < Production::FEED_COMPONENTS.size(); ++e){
+        const std::uint8_t component = Production::FEED_COMPONENTS[e];
+        const std::size_t count = counts[component == COMPONENT::EMPTY ? 0 : 1u << component];
+        const double expected = probabilities[e] / sum;
+        // 5 sigma of the binomial
+        REQUIRE(std::abs(static_cast<double>(count) / DRAWS - expected) <= 5 * std::sqrt(expected * (1 - expected) / DRAWS) + 1e-9);
+        seen += count;
+    }
+    REQUIRE(seen == DRAWS);
+}
+
+TEST_CASE("Alias table feeder draws the configured frequencies")
+{
+    Test_FeedFrequencies(Production::DEFAULT_FEED_PROBABILITIES);
+    Test_FeedFrequencies({0.05, 0.6, 0.0, 0.35});
+    Test_FeedFrequencies({1, 1, 1, 1});
+    Test_FeedFrequencies({0, 1, 0, 0});
+
+    REQUIRE_THROWS_AS(Production(1, {0.5, -0.1, 0.3, 0.3}), std::invalid_argument);
+    REQUIRE_THROWS_AS(Production(1, {0, 0, 0, 0}), std::invalid_argument);
+
+    // a feeder seeded at draw 50 carries on where one stopping after 50 draws left off
+    using Feeder = BulkFeeder<Production::FEED_COMPONENTS.size(), 64>;
+    const AliasTable<Production::FEED_COMPONENTS.size()> table(Production::DEFAULT_FEED_PROBABILITIES);
+    Feeder whole(Production::FEED_COMPONENTS, table, 7);
+    Feeder first(Production::FEED_COMPONENTS, table, 7, 50);
+    Feeder second(Production::FEED_COMPONENTS, table, Feeder::SeedAt(7, 50), 50);
+    for (std::size_t i = 0; i < 100; ++i)
+        REQUIRE(whole().bits == (i < 50 ? first() : second()).bits);
+}
+
+TEST_CASE("A second Start carries on with the feed of the first")
+{
+    for (const ENGINE engine : {ENGINE::SEQUENTIAL_ENGINE, ENGINE::THREADED_ENGINE}){
+        Production once(7), twice(7);
+        once.Start(100, engine);
+        twice.Start(50, engine);
+        twice.Start(50, engine);
+        REQUIRE(once.getm_noOfEmptyFeed() == twice.getm_noOfEmptyFeed());
+        REQUIRE(once.getm_noOfProductsFormed() == twice.getm_noOfProductsFormed());
+        REQUIRE(once.getm_noOfComponentsUnHandled() == twice.getm_noOfComponentsUnHandled());
+    }
+}
+
+template<class W>
+void Test_BitSlicedFeedFrequencies(const Production::FeedProbabilities& probabilities)
+{
+    using Line = BitSlicedProduction<W>;
+    Line line(1234, probabilities);
+
+    constexpr std::size_t TICKS = 4000;
+    constexpr std::size_t DRAWS = TICKS * Line::LANES;
+    std::array<std::size_t, Line::NO_OF_COMPONENT_BITS + 1> counts{};
+    for (std::size_t i = 0; i < TICKS; ++i){
+        W component[Line::NO_OF_COMPONENT_BITS]{};
+        line.RandomFeed(component);
+        for (std::size_t lane = 0; lane < Line::LANES; ++lane){
+            std::size_t fed = Line::NO_OF_COMPONENT_BITS;
+            for (std::size_t c = 0; c < Line::NO_OF_COMPONENT_BITS; ++c){
+                if (LaneTraits<W>::Test(component[c], lane)){
+                    if (fed != Line::NO_OF_COMPONENT_BITS)
+                        FAIL("lane fed two components at once");
+                    fed = c;
+                }
+            }
+            ++counts[fed];
+        }
+    }
+
+    double sum = 0.0;
+    for (const double p : probabilities)
+        sum += p;
+
+    for (std::size_t e = 0; e < Production::FEED_COMPONENTS.size(); ++e){
+        const std::uint8_t component = Production::FEED_COMPONENTS[e];
+        const std::size_t count = counts[component == COMPONENT::EMPTY ? Line::NO_OF_COMPONENT_BITS : component];
+        const double expected = probabilities[e] / sum;
+        // 5 sigma of the binomial plus the 2^-16 of the fixed point thresholds
+        REQUIRE(std::abs(static_cast<double>(count) / DRAWS - expected) <= 5 * std::sqrt(expected * (1 - expected) / DRAWS) + 1.0 / 65536);
+    }
+}
+
+TEST_CASE("Bit-sliced feed draws the configured frequencies")
+{
+    Test_BitSlicedFeedFrequencies<Lanes64>(Production::DEFAULT_FEED_PROBABILITIES);
+    Test_BitSlicedFeedFrequencies<Lanes256>({0.05, 0.6, 0.0, 0.35});
+    // a cumulative probability of 1 before the last entry
+    Test_BitSlicedFeedFrequencies<Lanes64>({1, 0, 0, 0});
+    Test_BitSlicedFeedFrequencies<Lanes64>({0, 1, 0, 0});
+    Test_BitSlicedFeedFrequencies<Lanes64>({0, 0, 0, 1});
+}
+
+#ifdef RUN_TRACE
+TEST_CASE("Trace records every feed and commit of a run")
+{
+    const std::string path = "factory-simulation-test.trace";
+    Tracer::Instance().Start(path);
+    Production p(1);
+    p.Start(50, ENGINE::SEQUENTIAL_ENGINE);
+    REQUIRE(Tracer::Instance().Stop() == 0);
+
+    std::ifstream in(path, std::ios::binary);
+    std::size_t noOfFeeds = 0;
+    std::uint64_t lastTick = 0;
+    TraceRecord record;
+    while (in.read(reinterpret_cast<char*>(&record), sizeof(record))){
+        // one thread, one ring: records come out in program order
+        REQUIRE(record.tick >= lastTick);
+        lastTick = record.tick;
+        if (record.event == TRACE_FEED){
+            REQUIRE(record.worker == p.getNoOfWorkers());
+            ++noOfFeeds;
+        }else{
+            REQUIRE(record.worker < p.getNoOfWorkers());
+        }
+        REQUIRE(record.slot < p.getNoOfSlots());
+    }
+    REQUIRE(noOfFeeds == 50);
+    std::remove(path.c_str());
+}
+#endif
+
+#ifdef RUN_LATENCY
+TEST_CASE("Latency histogram buckets bound every value within their resolution")
+{
+    LatencyHistogram h;
+    for (std::uint64_t ns = 1; ns <= 100000; ++ns){
+        const std::uint64_t upper = LatencyHistogram::UpperBoundOf(LatencyHistogram::BucketOf(ns));
+        REQUIRE(upper >= ns);
+        REQUIRE(upper - ns <= ns / LatencyHistogram::SUB_BUCKETS);
+        h.Record(ns);
+    }
+    REQUIRE(std::abs(static_cast<double>(h.getPercentile(0.5)) - 50000) <= 50000.0 / LatencyHistogram::SUB_BUCKETS);
+    REQUIRE(std::abs(static_cast<double>(h.getPercentile(0.99)) - 99000) <= 99000.0 / LatencyHistogram::SUB_BUCKETS);
+
+    // one feed per tick whichever engine
+    for (const ENGINE engine : {ENGINE::THREADED_ENGINE, ENGINE::SEQUENTIAL_ENGINE}){
+        Production p(1);
+        p.Start(20, engine);
+        REQUIRE(p.getPhaseLatency().getPhase(PHASE_FEED).getCount() == 20);
+    }
+}
+#endif
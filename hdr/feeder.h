@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+/*
+ * Walker/Vose alias table: O(1) draw of entry i with probability p[i] from one random word.
+ * The high 32 bits pick a column by multiply-shift, the low 32 bits are the coin against the
+ * column's threshold; no division and no loop. Column bias is below ENTRIES / 2^32.
+*/
+template<std::size_t ENTRIES>
+class AliasTable {
+
+public:
+    // probabilities need not be normalised but must be non-negative with a positive sum
+    explicit AliasTable(const std::array<double, ENTRIES>& probabilities){
+
+        double sum = 0.0;
+        for (const double p : probabilities){
+            if (!(p >= 0.0))
+                throw std::invalid_argument("AliasTable: negative probability");
+            sum += p;
+        }
+        if (!(sum > 0.0))
+            throw std::invalid_argument("AliasTable: probabilities sum to zero");
+
+        std::array<double, ENTRIES> scaled{};
+        std::array<std::size_t, ENTRIES> small{}, large{};
+        std::size_t noOfSmall = 0, noOfLarge = 0;
+        for (std::size_t i = 0; i < ENTRIES; ++i){
+            scaled[i] = probabilities[i] * ENTRIES / sum;
+            if (scaled[i] < 1.0)
+                small[noOfSmall++] = i;
+            else
+                large[noOfLarge++] = i;
+        }
+
+        while (noOfSmall > 0 && noOfLarge > 0){
+            const std::size_t s = small[--noOfSmall];
+            const std::size_t l = large[--noOfLarge];
+            m_Threshold[s] = ToFixed(scaled[s]);
+            m_Alias[s] = static_cast<std::uint8_t>(l);
+            scaled[l] -= 1.0 - scaled[s];
+            if (scaled[l] < 1.0)
+                small[noOfSmall++] = l;
+            else
+                large[noOfLarge++] = l;
+        }
+        // left overs are 1 up to rounding
+        while (noOfLarge > 0){
+            const std::size_t l = large[--noOfLarge];
+            m_Threshold[l] = FIXED_ONE;
+            m_Alias[l] = static_cast<std::uint8_t>(l);
+        }
+        while (noOfSmall > 0){
+            const std::size_t s = small[--noOfSmall];
+            m_Threshold[s] = FIXED_ONE;
+            m_Alias[s] = static_cast<std::uint8_t>(s);
+        }
+    }
+
+    inline std::size_t operator()(const std::uint64_t random) const noexcept{
+
+        const std::size_t column = ((random >> 32) * ENTRIES) >> 32;
+        return (random & 0xFFFFFFFFull) < m_Threshold[column] ? column : m_Alias[column];
+    }
+
+private:
+    static constexpr std::uint64_t FIXED_ONE = std::uint64_t{1} << 32;
+
+    static std::uint64_t ToFixed(const double p) noexcept{
+        return std::min<std::uint64_t>(FIXED_ONE, static_cast<std::uint64_t>(p * FIXED_ONE + 0.5));
+    }
+
+    static_assert(ENTRIES > 0 && ENTRIES <= 256, "alias index is a byte");
+
+    std::array<std::uint64_t, ENTRIES> m_Threshold{};
+    std::array<std::uint8_t, ENTRIES> m_Alias{};
+};
+
+/*
+ * Bulk component feeder. Fills a buffer of slots at once from a counter based generator
+ * (SplitMix64 of seed + i) drawn through an AliasTable, so every iteration of the refill loop
+ * is independent and the compiler is free to vectorise it.
+ * The tick loop then consumes the buffer one slot per tick. Same seed, same feed sequence, however
+ * the buffer is chunked; noOfDraws only keeps short runs from filling a buffer they never use.
+*/
+template<std::size_t ENTRIES, std::size_t BUFFER_SIZE = 4096>
+class BulkFeeder {
+
+public:
+    // COMPONENT::EMPTY entries feed an empty slot
+    BulkFeeder(const std::array<std::uint8_t, ENTRIES>& components, const AliasTable<ENTRIES>& table,
+               const std::uint64_t seed, const std::size_t noOfDraws = SIZE_MAX)
+        :m_Table(table)
+    {
+        for (std::size_t e = 0; e < ENTRIES; ++e){
+            SlotData data;
+            if (components[e] != COMPONENT::EMPTY)
+                data.SetComponentData(components[e]);
+            m_Entries[e] = data;
+        }
+        Reseed(seed, noOfDraws);
+    }
+
+    // the seed whose sequence is seed's from its draw-th draw on, for a run carrying on an earlier one
+    static constexpr std::uint64_t SeedAt(const std::uint64_t seed, const std::uint64_t draw) noexcept{
+        return seed + draw * GAMMA;
+    }
+
+    void Reseed(const std::uint64_t seed, const std::size_t noOfDraws = SIZE_MAX) noexcept{
+        m_Counter = seed;
+        m_DrawsLeft = noOfDraws;
+        m_Pos = m_Size = 0;
+    }
+
+    inline SlotData operator()() noexcept{
+
+        if (m_Pos == m_Size)[[unlikely]]
+            Refill();
+        return m_Buffer[m_Pos++];
+    }
+
+private:
+    // SplitMix64's increment
+    static constexpr std::uint64_t GAMMA = 0x9E3779B97F4A7C15ull;
+
+    void Refill() noexcept{
+
+        // past the announced number of draws keep going in full buffers
+        const std::size_t draws = std::max<std::size_t>(1, std::min(m_DrawsLeft, BUFFER_SIZE));
+        for (std::size_t i = 0; i < draws; ++i){
+            std::uint64_t z = m_Counter + (i + 1) * GAMMA;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= z >> 31;
+
+            m_Buffer[i] = m_Entries[m_Table(z)];
+        }
+        m_Counter += draws * GAMMA;
+        m_DrawsLeft = m_DrawsLeft > draws ? m_DrawsLeft - draws : SIZE_MAX;
+        m_Size = draws;
+        m_Pos = 0;
+    }
+
+    const AliasTable<ENTRIES>& m_Table;
+    std::array<SlotData, ENTRIES> m_Entries{};
+    std::array<SlotData, BUFFER_SIZE> m_Buffer{};
+    std::uint64_t m_Counter{0};
+    std::size_t m_DrawsLeft{SIZE_MAX};
+    std::size_t m_Pos{0};
+    std::size_t m_Size{0};
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+/*
+ * Per phase tick latency. Configure with -DRUN_LATENCY=ON to compile it in; otherwise the
+ * LATENCY_* macros expand to nothing and none of this exists.
+ * Every thread owns a PhaseLatency and marks the end of each phase with LATENCY_LAP, one clock
+ * read per phase boundary; the time since the previous lap goes to that phase's histogram.
+ * Threads never share a PhaseLatency, they are merged once the run is over.
+*/
+
+#include <cstdint>
+
+enum PHASE : std::uint8_t {
+
+    PHASE_FEEDER = 0,   // producer draws the next component
+    PHASE_BARRIER = 1,  // arrive on the tick barrier until released, includes the feed step for the last to arrive
+    PHASE_FEED = 2,     // barrier completion: exit decision, store of the fed slot
+    PHASE_PROCESS = 3,  // worker loads its slot and runs the state chart
+    PHASE_COMMIT = 4    // worker claims its slot with a compare-exchange on the atomic SlotData, or rolls back when it lost the claim
+};
+
+#ifdef RUN_LATENCY
+
+#include <array>
+#include <chrono>
+#include <ostream>
+
+/*
+ * Log-linear histogram of nanoseconds: every power of two split in 2^SUB_BITS linear buckets,
+ * so any recorded value is off by less than 1/2^SUB_BITS. Values below 2^SUB_BITS are exact.
+*/
+class LatencyHistogram {
+
+public:
+    static constexpr unsigned SUB_BITS = 4;
+    static constexpr unsigned SUB_BUCKETS = 1u << SUB_BITS;
+    // 2^40 ns is 18 minutes, anything longer lands in the last bucket
+    static constexpr unsigned MAX_EXPONENT = 40;
+    static constexpr std::size_t NO_OF_BUCKETS = (MAX_EXPONENT - SUB_BITS + 2) * SUB_BUCKETS;
+
+    inline void Record(const std::uint64_t ns) noexcept{
+        ++m_Counts[BucketOf(ns)];
+        ++m_Count;
+    }
+
+    void Merge(const LatencyHistogram& other) noexcept{
+
+        for (std::size_t b = 0; b < NO_OF_BUCKETS; ++b)
+            m_Counts[b] += other.m_Counts[b];
+        m_Count += other.m_Count;
+    }
+
+    std::uint64_t getCount() const noexcept { return m_Count; }
+
+    // upper bound of the bucket holding quantile q, 0 when empty
+    std::uint64_t getPercentile(const double q) const noexcept{
+
+        if (m_Count == 0)
+            return 0;
+        const std::uint64_t rank = static_cast<std::uint64_t>(q * (m_Count - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < NO_OF_BUCKETS; ++b){
+            seen += m_Counts[b];
+            if (seen >= rank)
+                return UpperBoundOf(b);
+        }
+        return UpperBoundOf(NO_OF_BUCKETS - 1);
+    }
+
+    static constexpr std::size_t BucketOf(const std::uint64_t ns) noexcept{
+
+        if (ns < SUB_BUCKETS)
+            return ns;
+        const unsigned exponent = 63 - __builtin_clzll(ns);
+        if (exponent > MAX_EXPONENT)
+            return NO_OF_BUCKETS - 1;
+        const unsigned shift = exponent - SUB_BITS;
+        return (shift + 1) * SUB_BUCKETS + ((ns >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    static constexpr std::uint64_t UpperBoundOf(const std::size_t bucket) noexcept{
+
+        if (bucket < SUB_BUCKETS)
+            return bucket;
+        const unsigned shift = bucket / SUB_BUCKETS - 1;
+        return ((SUB_BUCKETS + bucket % SUB_BUCKETS + 1) << shift) - 1;
+    }
+
+private:
+    std::array<std::uint32_t, NO_OF_BUCKETS> m_Counts{};
+    std::uint64_t m_Count{0};
+};
+
+class PhaseLatency {
+
+public:
+    static constexpr std::size_t NO_OF_PHASES = 5;
+    static constexpr const char* PHASE_NAMES[NO_OF_PHASES]{"feeder", "barrier", "feed", "process", "commit"};
+
+    // starts the first phase
+    inline void Start() noexcept{
+        m_Last = std::chrono::steady_clock::now();
+    }
+
+    // ends phase, the next one starts now
+    inline void Lap(const PHASE phase) noexcept{
+
+        const auto now = std::chrono::steady_clock::now();
+        m_Phases[phase].Record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_Last).count());
+        m_Last = now;
+    }
+
+    void Merge(const PhaseLatency& other) noexcept{
+
+        for (std::size_t p = 0; p < NO_OF_PHASES; ++p)
+            m_Phases[p].Merge(other.m_Phases[p]);
+    }
+
+    const LatencyHistogram& getPhase(const PHASE phase) const noexcept { return m_Phases[phase]; }
+
+    void Print(std::ostream& os) const{
+
+        for (std::size_t p = 0; p < NO_OF_PHASES; ++p){
+            const LatencyHistogram& h = m_Phases[p];
+            if (h.getCount() == 0)
+                continue;
+            os << "Latency " << PHASE_NAMES[p] << ": " << h.getCount() << " samples, p50 " << h.getPercentile(0.5)
+               << " ns, p99 " << h.getPercentile(0.99) << " ns, p999 " << h.getPercentile(0.999) << " ns" << std::endl;
+        }
+    }
+
+private:
+    std::array<LatencyHistogram, NO_OF_PHASES> m_Phases{};
+    std::chrono::steady_clock::time_point m_Last{};
+};
+
+#define LATENCY_START(LATENCY) (LATENCY).Start()
+#define LATENCY_LAP(LATENCY, PHASE) (LATENCY).Lap(PHASE)
+
+#else
+
+#define LATENCY_START(LATENCY) ((void)0)
+#define LATENCY_LAP(LATENCY, PHASE) ((void)0)
+
+#endif
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "production.h"
+#include "bitsliced.h"
+
+enum class BATCH_ENGINE : std::uint8_t {
+
+    SEQUENTIAL_BATCH,   // one sequential Production per run
+    BITSLICED_BATCH     // BitSlicedProduction, one lane per run
+};
+
+/*
+ * Running mean/variance (Welford). Two accumulators merge exactly (Chan et al.) so every
+ * pool thread keeps its own and they are folded together once the batch is over.
+*/
+class RunningStats {
+
+public:
+    void Add(const double x) noexcept{
+
+        ++m_Count;
+        const double delta = x - m_Mean;
+        m_Mean += delta / m_Count;
+        m_M2 += delta * (x - m_Mean);
+    }
+
+    void Merge(const RunningStats& other) noexcept{
+
+        if (other.m_Count == 0)
+            return;
+        if (m_Count == 0){
+            *this = other;
+            return;
+        }
+
+        const double count = static_cast<double>(m_Count + other.m_Count);
+        const double delta = other.m_Mean - m_Mean;
+        m_Mean += delta * other.m_Count / count;
+        m_M2 += other.m_M2 + delta * delta * m_Count * other.m_Count / count;
+        m_Count += other.m_Count;
+    }
+
+    std::size_t getCount() const noexcept { return m_Count; }
+    double getMean() const noexcept { return m_Mean; }
+
+    // sample variance
+    double getVariance() const noexcept {
+        return m_Count > 1 ? m_M2 / (m_Count - 1) : 0.0;
+    }
+
+    double getStdDev() const noexcept {
+        return std::sqrt(getVariance());
+    }
+
+    // half width of the normal approximation confidence interval of the mean, z = 1.96 for 95%
+    double getConfidenceHalfWidth(const double z = 1.96) const noexcept {
+        return m_Count > 0 ? z * getStdDev() / std::sqrt(static_cast<double>(m_Count)) : 0.0;
+    }
+
+private:
+    std::size_t m_Count{0};
+    double m_Mean{0.0};
+    double m_M2{0.0};
+};
+
+struct BatchResult {
+
+    RunningStats productsFormed;
+    RunningStats componentsUnHandled;
+    RunningStats emptyFeed;
+    RunningStats workersWithUnfinishedProducts;
+
+    void Merge(const BatchResult& other) noexcept{
+        productsFormed.Merge(other.productsFormed);
+        componentsUnHandled.Merge(other.componentsUnHandled);
+        emptyFeed.Merge(other.emptyFeed);
+        workersWithUnfinishedProducts.Merge(other.workersWithUnfinishedProducts);
+    }
+};
+
+/*
+ * Runs many independent seeded productions on a fixed pool of threads. Threads are created once
+ * and reused for every batch; runs never spawn threads of their own. Sequential runs are seeded
+ * from SplitMix64(baseSeed + i), bit-sliced chunks from SplitMix64(baseSeed + first run of chunk),
+ * so results do not depend on the number of threads or on which thread picked the run.
+*/
+class MonteCarlo {
+
+public:
+    explicit MonteCarlo(const std::size_t noOfThreads = CpuPlacement::getAvailableConcurrency()){
+
+        const std::size_t n = noOfThreads > 0 ? noOfThreads : 1;
+        for (std::size_t i = 0; i < n; ++i){
+            m_Pool.emplace_back(&MonteCarlo::PoolWork, this);
+        }
+    }
+
+    ~MonteCarlo(){
+        {
+            std::lock_guard lk(m_Mu);
+            m_Exit = true;
+        }
+        m_CondVar.notify_all();
+        for (auto& t : m_Pool){
+            t.join();
+        }
+    }
+
+    MonteCarlo(const MonteCarlo&) = delete;
+    MonteCarlo& operator=(const MonteCarlo&) = delete;
+
+    BatchResult Run(const std::size_t noOfRuns, const std::size_t runTime, const std::uint64_t baseSeed,
+                    const BATCH_ENGINE engine = BATCH_ENGINE::SEQUENTIAL_BATCH,
+                    const Production::FeedProbabilities& feedProbabilities = Production::DEFAULT_FEED_PROBABILITIES){
+
+        // reject a bad configuration here rather than inside a pool thread
+        AliasTable<Production::FEED_COMPONENTS.size()> validate(feedProbabilities);
+
+        std::unique_lock lk(m_Mu);
+        m_Engine = engine;
+        m_FeedProbabilities = feedProbabilities;
+        m_Result = BatchResult{};
+        m_NoOfRuns = noOfRuns;
+        m_RunTime = runTime;
+        m_BaseSeed = baseSeed;
+        m_Chunk = getChunk(engine, noOfRuns, m_Pool.size());
+        m_NextRun.store(0, std::memory_order_relaxed);
+        m_Busy = m_Pool.size();
+        ++m_Batch;
+        m_CondVar.notify_all();
+
+        m_CondVarDone.wait(lk, [this](){ return m_Busy == 0; });
+        return m_Result;
+    }
+
+    std::size_t getNoOfThreads() const noexcept { return m_Pool.size(); }
+
+    static std::uint64_t SplitMix64(std::uint64_t x) noexcept{
+
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+private:
+    void PoolWork(){
+
+        std::size_t seenBatch = 0;
+        while (true){
+            {
+                std::unique_lock lk(m_Mu);
+                m_CondVar.wait(lk, [&seenBatch, this](){ return m_Exit || m_Batch != seenBatch; });
+                if (m_Exit)
+                    return;
+                seenBatch = m_Batch;
+            }
+
+            // batch parameters are stable until every pool thread has reported back
+            BatchResult local;
+            while (true){
+                const std::size_t first = m_NextRun.fetch_add(m_Chunk, std::memory_order_relaxed);
+                if (first >= m_NoOfRuns)
+                    break;
+                const std::size_t last = std::min(first + m_Chunk, m_NoOfRuns);
+                if (m_Engine == BATCH_ENGINE::BITSLICED_BATCH)
+                    RunBitSliced(first, last, local);
+                else
+                    RunSequential(first, last, local);
+            }
+
+            std::lock_guard lk(m_Mu);
+            m_Result.Merge(local);
+            if (--m_Busy == 0)
+                m_CondVarDone.notify_one();
+        }
+    }
+
+    void RunSequential(const std::size_t first, const std::size_t last, BatchResult& local){
+
+        for (std::size_t run = first; run < last; ++run){
+            Production p(SplitMix64(m_BaseSeed + run), m_FeedProbabilities);
+            p.Start(m_RunTime, ENGINE::SEQUENTIAL_ENGINE);
+
+            local.productsFormed.Add(p.getm_noOfProductsFormed());
+            local.componentsUnHandled.Add(p.getm_noOfComponentsUnHandled());
+            local.emptyFeed.Add(p.getm_noOfEmptyFeed());
+            local.workersWithUnfinishedProducts.Add(p.getNoOfWorkersWithUnfinishedProducts());
+        }
+    }
+
+    void RunBitSliced(const std::size_t first, const std::size_t last, BatchResult& local){
+
+        // chunks are one bit-sliced production wide, the last one may leave lanes unused
+        BitSlicedProduction<Lanes256> p(SplitMix64(m_BaseSeed + first), m_FeedProbabilities);
+        p.Start(m_RunTime);
+
+        for (std::size_t lane = 0; lane < last - first; ++lane){
+            local.productsFormed.Add(p.getm_noOfProductsFormed(lane));
+            local.componentsUnHandled.Add(p.getm_noOfComponentsUnHandled(lane));
+            local.emptyFeed.Add(p.getm_noOfEmptyFeed(lane));
+            local.workersWithUnfinishedProducts.Add(p.getNoOfWorkersWithUnfinishedProducts(lane));
+        }
+    }
+
+    /*
+     * Runs claimed at once. A bit-sliced chunk is one production wide; sequential chunks are at most
+     * SEQUENTIAL_CHUNK and small enough that every pool thread gets a few of them.
+    */
+    static std::size_t getChunk(const BATCH_ENGINE engine, const std::size_t noOfRuns, const std::size_t noOfThreads) noexcept{
+
+        if (engine == BATCH_ENGINE::BITSLICED_BATCH)
+            return BitSlicedProduction<Lanes256>::LANES;
+        return std::clamp<std::size_t>(noOfRuns / (4 * noOfThreads), 1, SEQUENTIAL_CHUNK);
+    }
+
+    static constexpr std::size_t SEQUENTIAL_CHUNK = 64;
+
+    std::vector<std::thread> m_Pool;
+    std::mutex m_Mu;
+    std::condition_variable m_CondVar;
+    std::condition_variable m_CondVarDone;
+    bool m_Exit{false};
+    std::size_t m_Batch{0};
+    std::size_t m_Busy{0};
+
+    std::size_t m_NoOfRuns{0};
+    std::size_t m_RunTime{0};
+    std::uint64_t m_BaseSeed{0};
+    std::size_t m_Chunk{SEQUENTIAL_CHUNK};
+    BATCH_ENGINE m_Engine{BATCH_ENGINE::SEQUENTIAL_BATCH};
+    Production::FeedProbabilities m_FeedProbabilities{Production::DEFAULT_FEED_PROBABILITIES};
+    std::atomic<std::size_t> m_NextRun{0};
+    BatchResult m_Result;
+};
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*
+ * Where the threaded engine runs its threads. The default pins nothing and only names the threads;
+ * a pinned placement puts the producer on one CPU and each worker pair, both workers, on one CPU.
+ * Compact lays pairs out over the CPUs this process may use, NUMA node by node, so neighbouring
+ * pairs, and every pair writing the same cache line of worker state, run on one node near the producer's.
+ * Pinning and naming are Linux only and quietly do nothing elsewhere.
+*/
+class CpuPlacement {
+
+public:
+    static constexpr int NOT_PINNED = -1;
+
+    CpuPlacement() = default;
+
+    // pair i runs on pairCpus[i % pairCpus.size()]
+    CpuPlacement(const int producerCpu, std::vector<int> pairCpus)
+        :m_ProducerCpu(producerCpu),
+         m_PairCpus(std::move(pairCpus))
+    {}
+
+    /*
+     * Lines of worker state are handed to nodes in proportion to the node's allowed CPUs, pairs within a
+     * node spread over its CPUs in contiguous blocks. The producer feeds slot 0 and runs on the
+     * first CPU of the node holding pair 0.
+    */
+    static CpuPlacement Compact(const std::size_t noOfPairs, const std::size_t pairsPerLine){
+
+        const std::vector<std::vector<int>> nodes = getAllowedCpusByNode();
+        std::size_t noOfCpus = 0;
+        for (const auto& cpus : nodes)
+            noOfCpus += cpus.size();
+        if (noOfCpus == 0 || noOfPairs == 0)
+            return CpuPlacement();
+
+        const std::size_t noOfLines = (noOfPairs + pairsPerLine - 1) / pairsPerLine;
+        std::vector<int> pairCpus;
+        pairCpus.reserve(noOfPairs);
+        std::size_t cpusBefore = 0;
+        for (const auto& cpus : nodes){
+            const std::size_t firstPair = std::min(noOfPairs, noOfLines * cpusBefore / noOfCpus * pairsPerLine);
+            cpusBefore += cpus.size();
+            const std::size_t lastPair = std::min(noOfPairs, noOfLines * cpusBefore / noOfCpus * pairsPerLine);
+            for (std::size_t pair = firstPair; pair < lastPair; ++pair)
+                pairCpus.push_back(cpus[(pair - firstPair) * cpus.size() / (lastPair - firstPair)]);
+        }
+        const int producerCpu = pairCpus.front();
+        return CpuPlacement(producerCpu, std::move(pairCpus));
+    }
+
+    int getProducerCpu() const noexcept { return m_ProducerCpu; }
+
+    int getPairCpu(const std::size_t pair) const noexcept{
+        return m_PairCpus.empty() ? NOT_PINNED : m_PairCpus[pair % m_PairCpus.size()];
+    }
+
+    bool getIsPinned() const noexcept { return m_ProducerCpu != NOT_PINNED || !m_PairCpus.empty(); }
+
+    // whether two threads pinned to these CPUs, NOT_PINNED ones left out, would share a CPU
+    static bool getIsSharingCpus(std::vector<int> cpus){
+
+        cpus.erase(std::remove(cpus.begin(), cpus.end(), NOT_PINNED), cpus.end());
+        std::sort(cpus.begin(), cpus.end());
+        return std::adjacent_find(cpus.begin(), cpus.end()) != cpus.end();
+    }
+
+    /*
+     * Names the calling thread, at most 15 characters are kept, and pins it to cpu. NOT_PINNED hands
+     * the thread every CPU of the process back, it may have inherited a pinned creator's single one.
+    */
+    static void ApplyToThisThread(const std::string& name, const int cpu){
+#ifdef __linux__
+        const cpu_set_t& processCpus = getProcessCpus();
+        pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+        if (cpu == NOT_PINNED){
+            pthread_setaffinity_np(pthread_self(), sizeof(processCpus), &processCpus);
+            return;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)name;
+        (void)cpu;
+#endif
+    }
+
+    // CPUs sched_getaffinity allows, ascending
+    static std::vector<int> getAllowedCpus(){
+
+        std::vector<int> ret;
+#ifdef __linux__
+        cpu_set_t set;
+        if (sched_getaffinity(0, sizeof(set), &set) == 0){
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu){
+                if (CPU_ISSET(cpu, &set))
+                    ret.push_back(cpu);
+            }
+        }
+#endif
+        return ret;
+    }
+
+    // allowed CPUs grouped by NUMA node, nodes without any left out; one group when sysfs has no nodes
+    static std::vector<std::vector<int>> getAllowedCpusByNode(){
+
+        const std::vector<int> allowed = getAllowedCpus();
+        std::vector<std::vector<int>> ret;
+        std::vector<int> placed;
+        for (const int node : ParseCpuList(ReadLine("/sys/devices/system/node/online"))){
+            std::vector<int> cpus;
+            for (const int cpu : ParseCpuList(ReadLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"))){
+                if (std::binary_search(allowed.begin(), allowed.end(), cpu))
+                    cpus.push_back(cpu);
+            }
+            if (!cpus.empty()){
+                placed.insert(placed.end(), cpus.begin(), cpus.end());
+                ret.push_back(std::move(cpus));
+            }
+        }
+        if (placed.size() != allowed.size())
+            return allowed.empty() ? ret : std::vector<std::vector<int>>{allowed};
+        return ret;
+    }
+
+    /*
+     * CPUs this process can keep busy: the allowed CPUs, capped by the cgroup CPU quota rounded up,
+     * at least 1. Use it instead of std::thread::hardware_concurrency, which counts the whole host.
+     * Counted on the first call only, it takes a few syscalls and file reads and every barrier asks.
+    */
+    static std::size_t getAvailableConcurrency(){
+
+        static const std::size_t ret = CountAvailableConcurrency();
+        return ret;
+    }
+
+    // CPUs worth of quota, cgroup v2 cpu.max or v1 cfs quota over period; 0 when unlimited or unknown
+    static double getCgroupCpuQuota(){
+
+        // v2: "0::/some/group", v1 lines name their controllers
+        std::string v2Group;
+        std::ifstream cgroups("/proc/self/cgroup");
+        for (std::string line; std::getline(cgroups, line);){
+            if (line.rfind("0::", 0) == 0)
+                v2Group = line.substr(3);
+        }
+        for (const std::string& dir : {"/sys/fs/cgroup" + v2Group, std::string("/sys/fs/cgroup")}){
+            std::istringstream cpuMax(ReadLine(dir + "/cpu.max"));
+            std::string quota;
+            double period = 0.0;
+            if (cpuMax >> quota >> period)
+                return quota == "max" || period <= 0.0 ? 0.0 : std::stod(quota) / period;
+        }
+
+        const std::string quota = ReadLine("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+        const std::string period = ReadLine("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+        if (quota.empty() || period.empty() || std::stod(quota) <= 0.0 || std::stod(period) <= 0.0)
+            return 0.0;
+        return std::stod(quota) / std::stod(period);
+    }
+
+    // "0-3,8,10-11" as sysfs writes it, malformed parts are skipped
+    static std::vector<int> ParseCpuList(const std::string& list){
+
+        std::vector<int> ret;
+        std::istringstream in(list);
+        for (std::string range; std::getline(in, range, ',');){
+            int first = 0;
+            int last = 0;
+            char dash = 0;
+            std::istringstream r(range);
+            if (!(r >> first))
+                continue;
+            if (!(r >> dash >> last) || dash != '-')
+                last = first;
+            for (int cpu = first; cpu <= last; ++cpu)
+                ret.push_back(cpu);
+        }
+        return ret;
+    }
+
+private:
+#ifdef __linux__
+    // the CPUs of the first thread placed, taken before this class pinned any thread
+    static const cpu_set_t& getProcessCpus(){
+
+        static const cpu_set_t ret = [](){
+            cpu_set_t set;
+            if (sched_getaffinity(0, sizeof(set), &set) != 0){
+                CPU_ZERO(&set);
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+                    CPU_SET(cpu, &set);
+            }
+            return set;
+        }();
+        return ret;
+    }
+#endif
+
+    static std::size_t CountAvailableConcurrency(){
+
+        std::size_t ret = getAllowedCpus().size();
+        if (ret == 0)
+            ret = std::max(1u, std::thread::hardware_concurrency());
+        const double quota = getCgroupCpuQuota();
+        if (quota > 0.0)
+            ret = std::min(ret, static_cast<std::size_t>(quota + 0.999));
+        return std::max<std::size_t>(ret, 1);
+    }
+
+    static std::string ReadLine(const std::string& path){
+
+        std::ifstream in(path);
+        std::string ret;
+        std::getline(in, ret);
+        return ret;
+    }
+
+    int m_ProducerCpu{NOT_PINNED};
+    std::vector<int> m_PairCpus;
+};
+
+/*
+ * Places the calling thread for as long as it lives, then gives it back its CPUs and name. The
+ * producer is whichever thread calls Start, so it must not keep the placement of one run.
+*/
+class ScopedThreadPlacement {
+
+public:
+    ScopedThreadPlacement(const std::string& name, const int cpu){
+#ifdef __linux__
+        m_IsSaved = pthread_getname_np(pthread_self(), m_Name, sizeof(m_Name)) == 0 &&
+                    pthread_getaffinity_np(pthread_self(), sizeof(m_Cpus), &m_Cpus) == 0;
+#endif
+        CpuPlacement::ApplyToThisThread(name, cpu);
+    }
+
+    ScopedThreadPlacement(const ScopedThreadPlacement&) = delete;
+    ScopedThreadPlacement& operator=(const ScopedThreadPlacement&) = delete;
+
+    ~ScopedThreadPlacement(){
+#ifdef __linux__
+        if (!m_IsSaved)
+            return;
+        pthread_setname_np(pthread_self(), m_Name);
+        pthread_setaffinity_np(pthread_self(), sizeof(m_Cpus), &m_Cpus);
+#endif
+    }
+
+private:
+#ifdef __linux__
+    bool m_IsSaved{false};
+    char m_Name[16]{};
+    cpu_set_t m_Cpus;
+#endif
+};
@@ -1,189 +1,845 @@
 #pragma once
 
+#include <algorithm>
+#include <limits>
 #include <type_traits>
-#include <bitset>
 #include <atomic>
+#include <memory>
 #include <new>
 #include <mutex>
 #include <condition_variable>
 #include <array>
 #include <future>
 #include <vector>
-#include <shared_mutex>
 #include <deque>
 #include <variant>
 #include <random>
 #include <chrono>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 #define GETTER(OBJ) public:\
     const decltype(OBJ)& get##OBJ() const { return OBJ; }
 
+#include "barrier.h"
 #include "belt.h"
+#include "feeder.h"
+#include "trace.h"
+#include "latency.h"
 #include "worker.h"
 
-class Production {
+// How Production::Start advances the belt.
+enum class ENGINE : std::uint8_t {
+
+    THREADED_ENGINE,    // one thread per worker, ticks synchronised on a phase barrier
+    SEQUENTIAL_ENGINE,  // every worker stepped in a fixed order on the calling thread
+    PARTITIONED_ENGINE, // one thread per segment of neighbouring pairs, stepped in order, one barrier per tick
+    SYSTOLIC_ENGINE,    // segments along the belt, each running ahead as soon as its upstream neighbour is done
+    TEMPORAL_ENGINE     // calling thread, cache sized tiles of the belt advanced several ticks at a time
+};
+
+// Constants shared by every belt layout.
+struct ProductionDefaults {
+
+    // one pair per slot on a belt of three as the problem statement asks
+    static constexpr std::size_t DEFAULT_NO_OF_SLOTS = 3;
+    // whatever a WideSlotIndex can index, the belt's memory is the practical limit
+    static constexpr std::size_t MAX_NO_OF_SLOTS = std::numeric_limits<WideSlotIndex>::max();
+    // temporal engine: ticks a tile advances at once, and the bytes of slots plus station state a tile should fit in
+    static constexpr std::size_t DEFAULT_TICKS_PER_BLOCK = 8;
+    static constexpr std::size_t TEMPORAL_TILE_BYTES = 128 * 1024;
+
+    // this many neighbouring pairs write one cache line of each WorkerStore array
+    static constexpr std::size_t PAIRS_PER_STATE_LINE = WorkerStore<DYNAMIC_SLOTS>::STATIONS_PER_LINE / 2;
+
+    // the slot at the start of the belt holds one of these, EMPTY meaning nothing
+    static constexpr std::array<std::uint8_t, 4> FEED_COMPONENTS{COMPONENT::EMPTY, COMPONENT::COMPONENT_A, COMPONENT::COMPONENT_B, COMPONENT::COMPONENT_C};
+    using FeedProbabilities = std::array<double, FEED_COMPONENTS.size()>;
+    // as the problem statement asks: nothing 1/5, A 2/5, B 1/5, C 1/5
+    static constexpr FeedProbabilities DEFAULT_FEED_PROBABILITIES{0.2, 0.4, 0.2, 0.2};
+};
+
+/*
+ * One production line: a belt of NO_OF_SLOTS and one worker pair per slot, every loop bound a
+ * compile time constant. ProductionLine<DYNAMIC_SLOTS> is the same line with belt length and
+ * pair count (at most one pair per slot, pair i standing at slot i) chosen at construction.
+ * Use Production unless the size is a template parameter anyway.
+*/
+template<std::size_t NO_OF_SLOTS>
+class ProductionLine : public ProductionDefaults {
 
-    static constexpr std::uint8_t NO_OF_SLOTS = 3;
 public:
-    Production(){
+    // seed only drives the component feeder, fixed seeds make runs reproducible.
+    // throws std::invalid_argument for negative or all zero probabilities.
+    // noOfSlots and noOfPairs are only read by ProductionLine<DYNAMIC_SLOTS>.
+    explicit ProductionLine(const std::uint64_t seed = std::random_device{}(),
+                            const FeedProbabilities& feedProbabilities = DEFAULT_FEED_PROBABILITIES,
+                            const std::size_t noOfSlots = NO_OF_SLOTS,
+                            const std::size_t noOfPairs = NO_OF_SLOTS)
+        :m_Seed(seed),
+         m_FeedTable(feedProbabilities),
+         m_NoOfSlots(static_cast<SlotIndex<NO_OF_SLOTS>>(noOfSlots)),
+         m_NoOfPairs(static_cast<SlotIndex<NO_OF_SLOTS>>(noOfPairs)),
+         m_Belt(noOfSlots),
+         m_WorkerStates(2 * noOfPairs),
+         m_WorkerStats(2 * noOfPairs),
+         m_TickBarrier(static_cast<std::ptrdiff_t>(2 * getNoOfPairs() + 1), TickCompletion{this})
+    {
+#ifdef RUN_LATENCY
+        m_Latency.resize(getNoOfWorkers() + 2);
+#endif
+    }
+
+    void Start(const std::size_t runTime, const ENGINE engine = ENGINE::THREADED_ENGINE){
+
+#ifdef RUN_CATCH
+        auto componentFeeder = [](){
+            SlotData data;
+            data.SetComponentData(COMPONENT::COMPONENT_A);
+            return data;
+        };
+#else
+        // one draw per tick fed so far: a second Start carries on with the sequence of the first
+        BulkFeeder<FEED_COMPONENTS.size()> componentFeeder(FEED_COMPONENTS, m_FeedTable, BulkFeeder<FEED_COMPONENTS.size()>::SeedAt(m_Seed, m_Tick),
+                                                           runTime);
+#endif
 
-        // Assign the belt for the workers
-        for (uint8_t i = 0; i < NO_OF_SLOTS; ++i){
-            m_WorkerPairs.emplace_back(std::make_unique<WorkerPair<NO_OF_SLOTS>>(i, *this));
+        Start(runTime, engine, componentFeeder);
+    }
+
+    // Scripted belts: componentFeeder() is called once per tick and returns the slot to feed.
+    template<class Feeder>
+    void Start(const std::size_t runTime, const ENGINE engine, Feeder&& componentFeeder){
+
+#ifdef RUN_LATENCY
+        m_Latency.assign(m_Latency.size(), PhaseLatency{});
+#endif
+        m_ProducerSwitches = ContextSwitches{};
+        for (WorkerStats& stats : m_WorkerStats)
+            stats.contextSwitches = ContextSwitches{};
+        switch (engine){
+        case ENGINE::SEQUENTIAL_ENGINE:
+            RunSequential(runTime, componentFeeder);
+            break;
+        case ENGINE::PARTITIONED_ENGINE:
+            RunPartitioned(runTime, componentFeeder);
+            break;
+        case ENGINE::SYSTOLIC_ENGINE:
+            RunSystolic(runTime, componentFeeder);
+            break;
+        case ENGINE::TEMPORAL_ENGINE:
+            RunTemporal(runTime, componentFeeder);
+            break;
+        case ENGINE::THREADED_ENGINE:
+            RunThreaded(runTime, componentFeeder);
+            break;
         }
     }
 
-    std::future<void> getFuture() {
+    std::size_t getNoOfWorkersWithUnfinishedProducts(){
 
-        std::lock_guard lk(m_MuFutGuard);
-        std::promise<void> promise;
-        std::future<void> future = promise.get_future();
-        m_Promises.push_back(std::move(promise));
+        std::size_t ret = 0;
+        for (std::size_t station = 0; station < getNoOfWorkers(); ++station){
+            ret += StateChart<2 * NO_OF_SLOTS>(m_WorkerStates, station).getIsWorkersWithUnfinishedProducts();
+        }
 
-        return future;
+        return ret;
     }
 
-    std::promise<void> getPromise() {
+    const WorkerStats& getWorkerStats(const std::size_t station) const noexcept{
+        return m_WorkerStats[station];
+    }
 
-        std::lock_guard lk(m_MuProGuard);
-        std::cout << "m_MuProGuard: locked: " << ++takenCount << std::endl;
-        std::promise<void> promise;
-        std::future<void> future = promise.get_future();
-        m_Futures.push_back(std::move(future));
+    // every worker's counters summed
+    WorkerStats getContentionStats() const noexcept{
 
-        std::cout << "m_MuProGuard: locked: " << --takenCount << std::endl;
-        return promise;
+        WorkerStats ret;
+        for (const WorkerStats& stats : m_WorkerStats)
+            ret.Merge(stats);
+        return ret;
     }
 
-    void Start(const std::size_t runTime){
+#ifdef RUN_LATENCY
+    // every thread's histograms of the last Start merged
+    PhaseLatency getPhaseLatency() const{
 
-        // Trigger all workers
-        for (const auto& w : m_WorkerPairs){
-            w->Start();
+        PhaseLatency ret;
+        for (const PhaseLatency& latency : m_Latency)
+            ret.Merge(latency);
+        return ret;
+    }
+#endif
+
+    // threaded engine only, how threads wait on the tick barrier; takes effect from the next Start
+    void SetWaitPolicy(const WAIT_POLICY policy) noexcept{
+        m_TickBarrier.SetWaitPolicy(policy);
+    }
+
+    WAIT_POLICY getWaitPolicy() const noexcept { return m_TickBarrier.getWaitPolicy(); }
+
+    // partitioned and systolic engines only, 0 (the default) for one segment per available CPU; takes effect from the next Start
+    void SetNoOfSegments(const std::size_t noOfSegments) noexcept{
+        m_NoOfSegments = noOfSegments;
+    }
+
+    // segments the partitioned and systolic engines run, never more than pairs
+    std::size_t getNoOfSegments() const{
+
+        const std::size_t noOfSegments = m_NoOfSegments == 0 ? CpuPlacement::getAvailableConcurrency() : m_NoOfSegments;
+        return std::min(noOfSegments, getNoOfPairs());
+    }
+
+    // temporal engine only: ticks per block, at least 1, and slots per tile, 0 to fit TEMPORAL_TILE_BYTES
+    void SetTemporalBlock(const std::size_t ticksPerBlock, const std::size_t slotsPerTile = 0) noexcept{
+        m_TicksPerBlock = std::max<std::size_t>(ticksPerBlock, 1);
+        m_SlotsPerTile = slotsPerTile;
+    }
+
+    std::size_t getTicksPerBlock() const noexcept { return m_TicksPerBlock; }
+
+    std::size_t getSlotsPerTile() const noexcept{
+
+        constexpr std::size_t BYTES_PER_POSITION = ConveyorBelt<std::atomic<SlotData>, NO_OF_SLOTS>::BYTES_PER_SLOT +
+                                                   2 * (WorkerStore<2 * NO_OF_SLOTS>::BYTES_PER_WORKER + sizeof(WorkerStats));
+        return m_SlotsPerTile != 0 ? m_SlotsPerTile : std::max<std::size_t>(1, TEMPORAL_TILE_BYTES / BYTES_PER_POSITION);
+    }
+
+    // every engine but the sequential one, takes effect from the next Start
+    void SetPlacement(CpuPlacement placement){
+        m_Placement = std::move(placement);
+    }
+
+    const CpuPlacement& getPlacement() const noexcept { return m_Placement; }
+
+    // context switches of every thread of the threaded engine, producer included, during the last Start
+    ContextSwitches getContextSwitches() const noexcept{
+
+        ContextSwitches ret = m_ProducerSwitches;
+        for (const WorkerStats& stats : m_WorkerStats)
+            ret += stats.contextSwitches;
+        return ret;
+    }
+
+    constexpr std::size_t getNoOfSlots() const noexcept{
+
+        if constexpr (NO_OF_SLOTS == DYNAMIC_SLOTS)
+            return m_NoOfSlots;
+        else
+            return NO_OF_SLOTS;
+    }
+
+    constexpr std::size_t getNoOfPairs() const noexcept{
+
+        if constexpr (NO_OF_SLOTS == DYNAMIC_SLOTS)
+            return m_NoOfPairs;
+        else
+            return NO_OF_SLOTS;
+    }
+
+    constexpr std::size_t getNoOfWorkers() const noexcept{
+        return 2 * getNoOfPairs();
+    }
+
+private:
+    template<class Feeder>
+    void RunThreaded(const std::size_t runTime, Feeder& componentFeeder){
+
+        m_TicksLeft = runTime;
+        m_Exit.store(false, std::memory_order_relaxed);
+
+        // Assign the belt for the workers, on the first threaded run only: other engines never need them
+        if (m_WorkerPairs.empty()){
+            for (std::size_t pair = 0; pair < getNoOfPairs(); ++pair){
+                m_WorkerPairs.emplace_back(std::make_unique<WorkerPair<NO_OF_SLOTS>>(pair, *this));
+            }
         }
 
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> distrib(0, 4);
-        std::array<uint8_t, 5> component_array{0, COMPONENT::COMPONENT_A, COMPONENT::COMPONENT_B, COMPONENT::COMPONENT_C, COMPONENT::EMPTY};
+        // both workers of a pair share their pair's CPU
+        std::vector<int> threadCpus{m_Placement.getProducerCpu()};
+        for (std::size_t station = 0; station < getNoOfWorkers(); ++station){
+            threadCpus.push_back(m_Placement.getPairCpu(station / 2));
+        }
+        m_TickBarrier.SetWaitPolicy(getWaitPolicy(), CpuPlacement::getIsSharingCpus(std::move(threadCpus)));
 
-        auto componentFeeder = [component_array = std::move(component_array), &rd, &distrib, &gen](){
-            SlotData data;
-#ifdef RUN_CATCH
-            data.SetComponentData(COMPONENT::COMPONENT_A);
-#else
-            data.SetComponentData(component_array[distrib(gen)]);
-#endif
-            return data;
-        };
+        // Trigger all workers, before the producer is pinned: a new thread starts on its creator's CPUs
+        for (const auto& w : m_WorkerPairs){
+            w->Start();
+        }
+        const ContextSwitches switchesBefore = ContextSwitches::OfThisThread();
+        const ScopedThreadPlacement producerPlacement("fs-producer", m_Placement.getProducerCpu());
 
         /* 1. feed the belt
-         * 2. notify all workers on stand-by to work on designated slots at different cache lines simultaneously for exactly once.
-         * 3. once all workers raise done will continue loop
-         * 4. workers will take new promise after every loop while production will clear expired promises.
-         * like C++ 20 counting semaphores. life much easier.
+         * 2. release all workers on stand-by to work on designated slots at different cache lines simultaneously for exactly once.
+         * 3. once all workers arrive back on the tick barrier will continue loop.
+         * Feeding is the barrier's completion step so it runs exactly once between two ticks of work,
+         * while the next component is drawn here as the workers are still busy.
         */
+        LATENCY_START(m_Latency[getNoOfWorkers()]);
+        for (std::size_t i = 0; i < runTime; ++i){
+            m_PendingFeed = componentFeeder();
+            LATENCY_LAP(m_Latency[getNoOfWorkers()], PHASE_FEEDER);
+            m_TickBarrier.ArriveAndWait();
+            LATENCY_LAP(m_Latency[getNoOfWorkers()], PHASE_BARRIER);
+        }
 
-        static int c;
-
-        auto WaitForWorkers = [this](int i){
-            // Don't wait for workers until first feed
-            if (i == 0)
-                return;
-            std::lock_guard lk(m_MuProGuard);
-            std::cout << "m_MuProGuard: locked in prod: " << ++takenCount << std::endl;
-            for (int i = 0; i < 2 * NO_OF_SLOTS && i < m_Futures.size(); ++i){
-                m_Futures[i].get();
-                m_Futures.pop_front();
-            }
-            std::cout << "m_MuProGuard: locked in prod: " << --takenCount << std::endl;
-        };
-        auto NotifyWorkers = [this]() {
-            std::lock_guard lk(m_MuFutGuard);
-            for (int i = 0; i < 2 * NO_OF_SLOTS && i < m_Promises.size(); ++i){
-                m_Promises[i].set_value();
-                m_Promises.pop_front();
-            }
-        };
-        auto Feed = [this](SlotData& component){
-            // simultaneous read  but exclusive write with shared_mutex.
-            std::unique_lock lk(m_Mu);
-            //std::cout << "fed in index: " << (int)m_SlotIndexFed << std::endl;
-            if (component.testIsEmpty()) ++m_noOfEmptyFeed;
-            // Atomic load/store of slots in concecutive cachelines for avoid false sharing.
-            std::atomic_store_explicit(&m_Belt[m_SlotIndexFed], component, std::memory_order_release);
-        };
+        // last phase only wakes the workers to see the exit flag
+        m_TickBarrier.ArriveAndWait();
+
+        for (const auto& w : m_WorkerPairs){
+            w->Join();
+        }
+        m_ProducerSwitches += ContextSwitches::OfThisThread() - switchesBefore;
+    }
+
+    /*
+     * The belt cut into getNoOfSegments() runs of neighbouring pairs, each stepped in station order
+     * by a thread of its own, the producer feeding in the completion of one barrier of segments + 1.
+     * Pairs work distinct slots within a tick so segments never share a slot, no lock or rollback
+     * is needed and the result is the sequential engine's whatever the feed. As the belt advances
+     * a segment's slots shift by one each tick: the slot entering at its upstream end, last written
+     * by the neighbouring segment, is the only one changing threads.
+     * Segment threads count their context switches on the segment's first station.
+    */
+    template<class Feeder>
+    void RunPartitioned(const std::size_t runTime, Feeder& componentFeeder){
+
+        const std::size_t noOfSegments = getNoOfSegments();
+        m_TicksLeft = runTime;
+        m_Exit.store(false, std::memory_order_relaxed);
+        std::vector<int> threadCpus{m_Placement.getProducerCpu()};
+        for (std::size_t segment = 0; segment < noOfSegments; ++segment){
+            threadCpus.push_back(m_Placement.getPairCpu(getNoOfPairs() * segment / noOfSegments));
+        }
+        PhaseBarrier<TickCompletion> barrier(static_cast<std::ptrdiff_t>(noOfSegments + 1), TickCompletion{this}, getWaitPolicy(),
+                                             CpuPlacement::getIsSharingCpus(std::move(threadCpus)));
+
+        const std::size_t head = m_Head;
+        std::vector<std::future<void>> segments;
+        for (std::size_t segment = 0; segment < noOfSegments; ++segment){
+            const std::size_t firstPair = getNoOfPairs() * segment / noOfSegments;
+            const std::size_t lastPair = getNoOfPairs() * (segment + 1) / noOfSegments;
+            segments.push_back(std::async(std::launch::async, [this, &barrier, segment, firstPair, lastPair, head](){
+                StepSegment(barrier, segment, firstPair, lastPair, head);
+            }));
+        }
+        // only now, the segment threads start on the caller's CPUs and not on the producer's
+        const ContextSwitches switchesBefore = ContextSwitches::OfThisThread();
+        const ScopedThreadPlacement producerPlacement("fs-producer", m_Placement.getProducerCpu());
 
+        LATENCY_START(m_Latency[getNoOfWorkers()]);
         for (std::size_t i = 0; i < runTime; ++i){
-            auto component = componentFeeder();
-            m_SlotIndexFed = getSlotIndexAfter(m_SlotIndexFed, true);
-            WaitForWorkers(i);
-            Feed(component);
-            NotifyWorkers();
+            m_PendingFeed = componentFeeder();
+            LATENCY_LAP(m_Latency[getNoOfWorkers()], PHASE_FEEDER);
+            barrier.ArriveAndWait();
+            LATENCY_LAP(m_Latency[getNoOfWorkers()], PHASE_BARRIER);
         }
 
-        m_Exit.store(true, std::memory_order_relaxed);
+        // last phase only wakes the segments to see the exit flag
+        barrier.ArriveAndWait();
+
+        for (auto& segment : segments){
+            segment.get();
+        }
+        m_ProducerSwitches += ContextSwitches::OfThisThread() - switchesBefore;
     }
 
-    std::size_t getNoOfWorkersWithUnfinishedProducts(){
+    // head is the belt's at the start, moved on here every tick as the feed moves m_Head
+    template<class Barrier>
+    void StepSegment(Barrier& barrier, const std::size_t segment, const std::size_t firstPair, const std::size_t lastPair, std::size_t head){
+
+        const ContextSwitches switchesBefore = ContextSwitches::OfThisThread();
+        CpuPlacement::ApplyToThisThread("fs-segment-" + std::to_string(segment), m_Placement.getPairCpu(firstPair));
+
+        LATENCY_START(m_Latency[2 * firstPair]);
+        while (true){
+            barrier.ArriveAndWait();
+            LATENCY_LAP(m_Latency[2 * firstPair], PHASE_BARRIER);
+            if (m_Exit.load(std::memory_order_relaxed))
+                break;
+
+            head = getSlotAfter(head);
+            for (std::size_t pair = firstPair; pair < lastPair; ++pair){
+                const std::size_t slot = getSlotOfPair(pair, head);
+                StepStation(2 * pair, slot, m_Tick);
+                StepStation(2 * pair + 1, slot, m_Tick);
+            }
+            LATENCY_LAP(m_Latency[2 * firstPair], PHASE_PROCESS);
+        }
+        m_WorkerStats[2 * firstPair].contextSwitches += ContextSwitches::OfThisThread() - switchesBefore;
+    }
 
-        std::size_t ret = 0;
-        for (const auto& w : m_WorkerPairs){
-            ret += w->getNoOfWorkersWithUnfinishedProducts();
+    /*
+     * Wavefront over the belt without a global barrier. Pair i works position i - 1 from the slot
+     * fed last, pair 0 the last position, so in position order the pairs are 1, 2, .., P - 1, 0;
+     * getNoOfSegments() segments cut that order in runs. Slots only move downstream, so segment k
+     * can step tick t once segment k - 1 has published tick t - 1: the slot crossing into k is then
+     * final. Segment 0 owns position 0, runs on the calling thread and feeds; the feed reuses the
+     * slot leaving the last position, so it waits on the last segment the same way, closing the
+     * ring. A slow segment only holds up the segments downstream of it, up to a lap of the ring.
+     * Every segment publishes its ticks done in a WaitWord, a single producer/single consumer
+     * channel read by its downstream neighbour only. Results are the sequential engine's.
+    */
+    template<class Feeder>
+    void RunSystolic(const std::size_t runTime, Feeder& componentFeeder){
+
+        const std::size_t noOfSegments = getNoOfSegments();
+        // segment 0 runs on the caller, placed as the producer
+        std::vector<int> threadCpus{m_Placement.getProducerCpu()};
+        for (std::size_t segment = 1; segment < noOfSegments; ++segment){
+            threadCpus.push_back(m_Placement.getPairCpu(SystolicPair(getNoOfPairs() * segment / noOfSegments)));
+        }
+        const WAIT_POLICY policy = WaitWord::Effective(getWaitPolicy(), noOfSegments, CpuPlacement::getIsSharingCpus(std::move(threadCpus)));
+        const std::unique_ptr<WaitWord[]> ticksDone(new WaitWord[noOfSegments]);
+        const std::uint64_t firstTick = m_Tick;
+        const std::size_t firstHead = m_Head;
+
+        std::vector<std::future<void>> segments;
+        for (std::size_t segment = 1; segment < noOfSegments; ++segment){
+            segments.push_back(std::async(std::launch::async, [&, segment](){
+                const ContextSwitches switchesBefore = ContextSwitches::OfThisThread();
+                const std::size_t firstPair = SystolicPair(getNoOfPairs() * segment / noOfSegments);
+                CpuPlacement::ApplyToThisThread("fs-segment-" + std::to_string(segment), m_Placement.getPairCpu(firstPair));
+                StepSystolicSegment(runTime, segment, noOfSegments, ticksDone.get(), policy, firstTick, firstHead, [](){});
+                m_WorkerStats[2 * firstPair].contextSwitches += ContextSwitches::OfThisThread() - switchesBefore;
+            }));
         }
 
-        return ret;
+        const ContextSwitches switchesBefore = ContextSwitches::OfThisThread();
+        {
+            const ScopedThreadPlacement producerPlacement("fs-producer", m_Placement.getProducerCpu());
+            StepSystolicSegment(runTime, 0, noOfSegments, ticksDone.get(), policy, firstTick, firstHead, [this, &componentFeeder](){
+                Feed(componentFeeder());
+            });
+        }
+        m_ProducerSwitches += ContextSwitches::OfThisThread() - switchesBefore;
+
+        for (auto& segment : segments){
+            segment.get();
+        }
     }
 
-private:
-    std::uint8_t getSlotIndexAfter(std::int8_t currIndex, const bool isWrite=false) noexcept{
+    // pair at position order index i, see RunSystolic
+    std::size_t SystolicPair(const std::size_t i) const noexcept{
+        return (i + 1) % getNoOfPairs();
+    }
 
-        /*
-         * progress belt by rotating the buffer index. overridden buffer is checked for
-         * unhandled component or completed product.
-        */
-        std::uint8_t ret_index;
-        if (--currIndex < 0){
-            ret_index = NO_OF_SLOTS - 1;
-            if (isWrite){
-                SlotData* ptr = std::launder(reinterpret_cast<SlotData*>(&m_Belt[ret_index]));
-                if (ptr->AnyComponent()){
-                    ++m_noOfComponentsUnHandled;
-                }else if (!ptr->testIsEmpty()){
-                    ++m_noOfProductsFormed;
+    template<class FeedFunction>
+    void StepSystolicSegment(const std::size_t runTime, const std::size_t segment, const std::size_t noOfSegments, WaitWord* ticksDone,
+                             const WAIT_POLICY policy, const std::uint64_t firstTick, std::size_t head, FeedFunction&& feed){
+
+        const std::size_t first = getNoOfPairs() * segment / noOfSegments;
+        const std::size_t last = getNoOfPairs() * (segment + 1) / noOfSegments;
+        WaitWord& upstream = ticksDone[(segment + noOfSegments - 1) % noOfSegments];
+
+        for (std::size_t tick = 0; tick < runTime; ++tick){
+            // the word wraps after 2^32 ticks, the difference stays right as segments are never more than a ring apart
+            const std::uint32_t needed = static_cast<std::uint32_t>(tick);
+            upstream.WaitUntil([needed](const std::uint32_t done){ return static_cast<std::int32_t>(done - needed) >= 0; }, policy);
+            feed();
+            // every segment counts the head on its own, m_Head is a lap ahead at most
+            head = getSlotAfter(head);
+            for (std::size_t i = first; i < last; ++i){
+                const std::size_t pair = SystolicPair(i);
+                const std::size_t slot = getSlotOfPair(pair, head);
+                StepStation(2 * pair, slot, firstTick + tick + 1);
+                StepStation(2 * pair + 1, slot, firstTick + tick + 1);
+            }
+            ticksDone[segment].Store(needed + 1);
+        }
+    }
+
+    /*
+     * Time skewed sequential engine. Without blocking every tick streams the whole belt and all
+     * station state through the cache; here a tile of getSlotsPerTile() slots is advanced
+     * getTicksPerBlock() ticks before the next tile is touched.
+     * A tile is a set of slots, so it moves one position downstream per tick, a parallelogram in
+     * (position, tick). A slot only depends on itself and the station it passes, a station on the
+     * slots it saw before, and those came from further downstream tiles in the earlier ticks of the
+     * block: tiles run from the end of the belt back to the feed. Slots fed during the block make up
+     * a triangle at the upstream end, stepped last, feeding tick by tick. Feeds only reuse slots that
+     * already left the belt, and every station still sees its ticks in order, so the result is the
+     * sequential engine's.
+    */
+    template<class Feeder>
+    void RunTemporal(const std::size_t runTime, Feeder& componentFeeder){
+
+        const std::size_t tile = getSlotsPerTile();
+        LATENCY_START(m_Latency[getNoOfWorkers()]);
+        for (std::size_t blockStart = 0; blockStart < runTime; blockStart += m_TicksPerBlock){
+            const std::size_t noOfTicks = std::min(m_TicksPerBlock, runTime - blockStart);
+
+            Feed(componentFeeder());
+            LATENCY_LAP(m_Latency[getNoOfWorkers()], PHASE_FEED);
+            const std::uint64_t firstTick = m_Tick;
+            const std::size_t firstHead = m_Head;
+
+            // position p at the first tick of the block is at p + tick later on
+            for (std::size_t end = getNoOfSlots(); end > 0; end -= std::min(end, tile)){
+                const std::size_t begin = end - std::min(end, tile);
+                std::size_t head = firstHead;
+                for (std::size_t tick = 0; tick < noOfTicks; ++tick, head = getSlotAfter(head)){
+                    for (std::size_t position = begin + tick; position < std::min(end + tick, getNoOfSlots()); ++position){
+                        StepPosition(position, head, firstTick + tick);
+                    }
                 }
+                LATENCY_LAP(m_Latency[getNoOfWorkers()], PHASE_PROCESS);
+            }
+
+            // slots fed during the block, position p at tick > p; a block longer than the belt feeds every slot again
+            for (std::size_t tick = 1; tick < noOfTicks; ++tick){
+                Feed(componentFeeder());
+                for (std::size_t position = 0; position < std::min(tick, getNoOfSlots()); ++position){
+                    StepPosition(position, m_Head, firstTick + tick);
+                }
+            }
+            LATENCY_LAP(m_Latency[getNoOfWorkers()], PHASE_PROCESS);
+        }
+    }
+
+    // both workers of the pair at position from the slot fed last, if there is one: pair i works position i - 1
+    void StepPosition(const std::size_t position, const std::size_t head, const std::uint64_t tick) noexcept{
+
+        const std::size_t pair = (position + 1) % getNoOfSlots();
+        if (pair < getNoOfPairs()){
+            const std::size_t slot = getSlotOfPair(pair, head);
+            StepStation(2 * pair, slot, tick);
+            StepStation(2 * pair + 1, slot, tick);
+        }
+    }
+
+    /*
+     * Same tick as RunThreaded but every worker is stepped inline, walking the worker store in
+     * station order: pair by pair, first worker of a pair first. The first worker to update a slot
+     * always wins so no lock or rollback is needed, and the belt is only touched with relaxed
+     * loads/stores which are plain moves.
+    */
+    template<class Feeder>
+    void RunSequential(const std::size_t runTime, Feeder& componentFeeder){
+
+        // one thread, all phases go to the producer's histograms
+        LATENCY_START(m_Latency[getNoOfWorkers()]);
+        for (std::size_t i = 0; i < runTime; ++i){
+            const SlotData component = componentFeeder();
+            LATENCY_LAP(m_Latency[getNoOfWorkers()], PHASE_FEEDER);
+            Feed(component);
+            LATENCY_LAP(m_Latency[getNoOfWorkers()], PHASE_FEED);
+            for (std::size_t pair = 0; pair < getNoOfPairs(); ++pair){
+                const std::size_t slot = getSlotOfPair(pair, m_Head);
+                StepStation(2 * pair, slot, m_Tick);
+                StepStation(2 * pair + 1, slot, m_Tick);
+                LATENCY_LAP(m_Latency[getNoOfWorkers()], PHASE_PROCESS);
             }
-        }else{
-            ret_index = currIndex;
         }
+    }
+
+    // slot is the station's pair's, see getSlotOfPair; tick only goes to the trace
+    void StepStation(const std::size_t station, const std::size_t slotIndex, [[maybe_unused]] const std::uint64_t tick) noexcept{
+
+        const SlotData s_read = m_Belt[slotIndex].load(std::memory_order_relaxed);
+        SlotData s_cur = s_read;
+        if (s_cur.testIsUpdated()){
+            ++m_WorkerStats[station].skippedUpdated;
+            TRACE(tick, station, TRACE_SKIP, slotIndex);
+            return;
+        }
+
+        StateChart<2 * NO_OF_SLOTS> workFlow(m_WorkerStates, station);
+        workFlow.Process(s_cur);
+
+        if (s_cur.testIsUpdated()){
+            s_cur.NextGeneration(s_read);
+            m_Belt[slotIndex].store(s_cur, std::memory_order_relaxed);
+            workFlow.Commit();
+            ++m_WorkerStats[station].commits;
+            TRACE(tick, station, TRACE_COMMIT, slotIndex, s_cur.bits);
+        }
+    }
 
-        return ret_index;
+    // Runs on the last thread to arrive on the tick barrier while everyone else is parked.
+    // Exit is decided here too so every worker sees it in the same phase.
+    void FeedStep() noexcept{
+
+        if (m_TicksLeft == 0){
+            m_Exit.store(true, std::memory_order_relaxed);
+            return;
+        }
+        --m_TicksLeft;
+
+        // completions never overlap so they share one set of histograms whatever thread runs them
+        LATENCY_START(m_Latency[getNoOfWorkers() + 1]);
+        // no lock, the barrier orders the feed after every worker's tick and before the next
+        Feed(m_PendingFeed);
+        LATENCY_LAP(m_Latency[getNoOfWorkers() + 1], PHASE_FEED);
     }
 
-    std::int8_t m_SlotIndexFed{1};
+    /*
+     * The slot at the head, worked by pair 0 on the tick before, leaves the belt: it is checked once
+     * for an unhandled component or a completed product and reused for the new component. The head
+     * then moves on so the new slot is pair 1's.
+    */
+    void Feed(SlotData component) noexcept{
+
+        const std::size_t slotIndex = m_Head;
+        const SlotData departing = m_Belt[slotIndex].load(std::memory_order_relaxed);
+        if (departing.AnyComponent()){
+            ++m_noOfComponentsUnHandled;
+        }else if (!departing.testIsEmpty()){
+            ++m_noOfProductsFormed;
+        }
+        m_Head = static_cast<SlotIndex<NO_OF_SLOTS>>(getSlotAfter(slotIndex));
+        ++m_Tick;
+        component.NextGeneration(departing);
+
+        TRACE(m_Tick, getNoOfWorkers(), TRACE_FEED, slotIndex, component.bits);
+        if (component.testIsEmpty()) ++m_noOfEmptyFeed;
+        // Atomic load/store of slots in concecutive cachelines for avoid false sharing.
+        std::atomic_store_explicit(&m_Belt[slotIndex], component, std::memory_order_release);
+    }
+
+    struct TickCompletion {
+        ProductionLine* prod;
+        void operator()() noexcept { prod->FeedStep(); }
+    };
+
+    /*
+     * The belt is a ring walked towards slot 0, one slot per tick. Pair i works the slot i after the
+     * head, so every engine finds a pair's slot from the head alone, and a thread that knows the
+     * head once can follow it tick by tick with getSlotAfter instead of reading m_Head.
+    */
+    std::size_t getSlotOfPair(const std::size_t pair, const std::size_t head) const noexcept{
+
+        const std::size_t slotIndex = head + pair;
+        return slotIndex < getNoOfSlots() ? slotIndex : slotIndex - getNoOfSlots();
+    }
+
+    // where the slot, or the head, is one tick later
+    std::size_t getSlotAfter(const std::size_t slotIndex) const noexcept{
+        return slotIndex == 0 ? getNoOfSlots() - 1 : slotIndex - 1;
+    }
+
+    const std::uint64_t m_Seed;
+    const AliasTable<FEED_COMPONENTS.size()> m_FeedTable;
+    const SlotIndex<NO_OF_SLOTS> m_NoOfSlots;
+    const SlotIndex<NO_OF_SLOTS> m_NoOfPairs;
+    // slot the next feed reuses, worked by pair 0 until then; only written by Feed
+    SlotIndex<NO_OF_SLOTS> m_Head{0};
     ConveyorBelt<std::atomic<SlotData>, NO_OF_SLOTS> m_Belt;
+    WorkerStore<2 * NO_OF_SLOTS> m_WorkerStates;
+    std::vector<WorkerStats> m_WorkerStats;
+    ContextSwitches m_ProducerSwitches;
+    CpuPlacement m_Placement;
+    std::size_t m_NoOfSegments{0};
+    std::size_t m_TicksPerBlock{DEFAULT_TICKS_PER_BLOCK};
+    std::size_t m_SlotsPerTile{0};
     std::vector<std::unique_ptr<WorkerPair<NO_OF_SLOTS>>> m_WorkerPairs; // Not array intentionally
-    std::shared_mutex m_Mu;
-
-    std::atomic_bool m_Exit;
+    alignas(64) std::atomic_bool m_Exit{false};
+    std::size_t m_TicksLeft{0};
+    // ticks fed so far, only written in the barrier completion so workers read it unlocked
+    std::uint64_t m_Tick{0};
+    SlotData m_PendingFeed;
+    // producer + 2 workers per pair
+    PhaseBarrier<TickCompletion> m_TickBarrier;
 
     std::size_t m_noOfProductsFormed{0};
     std::size_t m_noOfComponentsUnHandled{0};
     std::size_t m_noOfEmptyFeed{0};
 
+#ifdef RUN_LATENCY
+    // one per worker thread, then the producer, then the barrier completion
+    std::vector<PhaseLatency> m_Latency;
+#endif
+
     // just to keep less verbose
     template<std::size_t N>
     friend class Worker;
 
-    // If c++20 use counting semaphore
-    std::mutex m_MuProGuard;
-    std::deque<std::promise<void>> m_Promises;
-    std::mutex m_MuFutGuard;
-    std::deque<std::future<void>> m_Futures;
-
-    static inline int takenCount{0};
     GETTER(m_noOfEmptyFeed);
     GETTER(m_noOfProductsFormed);
     GETTER(m_noOfComponentsUnHandled);
 };
+
+/*
+ * Production with belt length and pair count chosen at run time. Common belts (FAST_PATH_SLOTS,
+ * one pair per slot) run on their own ProductionLine instantiation, picked through a dispatch
+ * table at construction; any other layout runs on ProductionLine<DYNAMIC_SLOTS>.
+ * Each call visits the line once, the tick loops themselves never dispatch.
+*/
+class Production : public ProductionDefaults {
+
+public:
+    static constexpr std::array<std::size_t, 6> FAST_PATH_SLOTS{3, 4, 8, 16, 32, 64};
+
+    // noOfPairs 0 means one pair per slot.
+    // throws std::invalid_argument for bad probabilities, a belt of 0 or more than MAX_NO_OF_SLOTS
+    // slots, or more pairs than slots.
+    explicit Production(const std::uint64_t seed = std::random_device{}(),
+                        const FeedProbabilities& feedProbabilities = DEFAULT_FEED_PROBABILITIES,
+                        const std::size_t noOfSlots = DEFAULT_NO_OF_SLOTS,
+                        const std::size_t noOfPairs = 0)
+        :m_Line(MakeLine(seed, feedProbabilities, noOfSlots, noOfPairs == 0 ? noOfSlots : noOfPairs))
+    {}
+
+    void Start(const std::size_t runTime, const ENGINE engine = ENGINE::THREADED_ENGINE){
+        std::visit([&](auto& line){ line.Start(runTime, engine); }, m_Line);
+    }
+
+    // Scripted belts: componentFeeder() is called once per tick and returns the slot to feed.
+    template<class Feeder>
+    void Start(const std::size_t runTime, const ENGINE engine, Feeder&& componentFeeder){
+        std::visit([&](auto& line){ line.Start(runTime, engine, componentFeeder); }, m_Line);
+    }
+
+    std::size_t getNoOfWorkersWithUnfinishedProducts(){
+        return std::visit([](auto& line){ return line.getNoOfWorkersWithUnfinishedProducts(); }, m_Line);
+    }
+
+    std::size_t getNoOfSlots() const noexcept{
+        return std::visit([](const auto& line){ return line.getNoOfSlots(); }, m_Line);
+    }
+
+    std::size_t getNoOfPairs() const noexcept{
+        return std::visit([](const auto& line){ return line.getNoOfPairs(); }, m_Line);
+    }
+
+    std::size_t getNoOfWorkers() const noexcept{
+        return 2 * getNoOfPairs();
+    }
+
+    // whether the layout got its own instantiation
+    bool getIsFastPath() const noexcept{
+        return m_Line.index() != FAST_PATH_SLOTS.size();
+    }
+
+    std::size_t getm_noOfEmptyFeed() const noexcept{
+        return std::visit([](const auto& line){ return line.getm_noOfEmptyFeed(); }, m_Line);
+    }
+
+    std::size_t getm_noOfProductsFormed() const noexcept{
+        return std::visit([](const auto& line){ return line.getm_noOfProductsFormed(); }, m_Line);
+    }
+
+    std::size_t getm_noOfComponentsUnHandled() const noexcept{
+        return std::visit([](const auto& line){ return line.getm_noOfComponentsUnHandled(); }, m_Line);
+    }
+
+    WorkerStats getWorkerStats(const std::size_t station) const noexcept{
+        return std::visit([station](const auto& line){ return line.getWorkerStats(station); }, m_Line);
+    }
+
+    WorkerStats getContentionStats() const noexcept{
+        return std::visit([](const auto& line){ return line.getContentionStats(); }, m_Line);
+    }
+
+    void SetWaitPolicy(const WAIT_POLICY policy) noexcept{
+        std::visit([policy](auto& line){ line.SetWaitPolicy(policy); }, m_Line);
+    }
+
+    WAIT_POLICY getWaitPolicy() const noexcept{
+        return std::visit([](const auto& line){ return line.getWaitPolicy(); }, m_Line);
+    }
+
+    ContextSwitches getContextSwitches() const noexcept{
+        return std::visit([](const auto& line){ return line.getContextSwitches(); }, m_Line);
+    }
+
+    void SetPlacement(const CpuPlacement& placement){
+        std::visit([&placement](auto& line){ line.SetPlacement(placement); }, m_Line);
+    }
+
+    void SetNoOfSegments(const std::size_t noOfSegments) noexcept{
+        std::visit([noOfSegments](auto& line){ line.SetNoOfSegments(noOfSegments); }, m_Line);
+    }
+
+    std::size_t getNoOfSegments() const{
+        return std::visit([](const auto& line){ return line.getNoOfSegments(); }, m_Line);
+    }
+
+    void SetTemporalBlock(const std::size_t ticksPerBlock, const std::size_t slotsPerTile = 0) noexcept{
+        std::visit([=](auto& line){ line.SetTemporalBlock(ticksPerBlock, slotsPerTile); }, m_Line);
+    }
+
+    std::size_t getTicksPerBlock() const noexcept{
+        return std::visit([](const auto& line){ return line.getTicksPerBlock(); }, m_Line);
+    }
+
+    std::size_t getSlotsPerTile() const noexcept{
+        return std::visit([](const auto& line){ return line.getSlotsPerTile(); }, m_Line);
+    }
+
+    // CpuPlacement::Compact for this line's pairs
+    void SetCompactPlacement(){
+        SetPlacement(CpuPlacement::Compact(getNoOfPairs(), PAIRS_PER_STATE_LINE));
+    }
+
+    const CpuPlacement& getPlacement() const noexcept{
+        return std::visit([](const auto& line) -> const CpuPlacement& { return line.getPlacement(); }, m_Line);
+    }
+
+#ifdef RUN_LATENCY
+    PhaseLatency getPhaseLatency() const{
+        return std::visit([](const auto& line){ return line.getPhaseLatency(); }, m_Line);
+    }
+#endif
+
+    // cache footprint of one worker: its state in the flat store and its own line of stats
+    static constexpr std::size_t getBytesPerWorker() noexcept{
+        return WorkerStore<DYNAMIC_SLOTS>::BYTES_PER_WORKER + sizeof(WorkerStats);
+    }
+
+    // belt slot plus the state of the workers standing at it
+    double getBytesPerSlot() const noexcept{
+        return ConveyorBelt<std::atomic<SlotData>, DYNAMIC_SLOTS>::BYTES_PER_SLOT +
+               static_cast<double>(getBytesPerWorker() * getNoOfWorkers()) / getNoOfSlots();
+    }
+
+private:
+    template<class Seq>
+    struct LineVariant;
+
+    template<std::size_t... I>
+    struct LineVariant<std::index_sequence<I...>> {
+        using type = std::variant<ProductionLine<FAST_PATH_SLOTS[I]>..., ProductionLine<DYNAMIC_SLOTS>>;
+    };
+
+    using Line = LineVariant<std::make_index_sequence<FAST_PATH_SLOTS.size()>>::type;
+    using LineFactory = Line (*)(std::uint64_t, const FeedProbabilities&, std::size_t, std::size_t);
+
+    // lines hold a barrier and mutexes so they are built in place, never moved
+    template<std::size_t I>
+    static Line MakeLineAt(const std::uint64_t seed, const FeedProbabilities& feedProbabilities,
+                           const std::size_t noOfSlots, const std::size_t noOfPairs){
+        return Line(std::in_place_index<I>, seed, feedProbabilities, noOfSlots, noOfPairs);
+    }
+
+    template<std::size_t... I>
+    static constexpr std::array<LineFactory, sizeof...(I)> MakeDispatchTable(std::index_sequence<I...>) noexcept{
+        return {&MakeLineAt<I>...};
+    }
+
+    static Line MakeLine(const std::uint64_t seed, const FeedProbabilities& feedProbabilities,
+                         const std::size_t noOfSlots, const std::size_t noOfPairs){
+
+        if (noOfSlots == 0 || noOfSlots > MAX_NO_OF_SLOTS)
+            throw std::invalid_argument("Production: belt length must be 1.." + std::to_string(MAX_NO_OF_SLOTS));
+        if (noOfPairs > noOfSlots)
+            throw std::invalid_argument("Production: more worker pairs than slots");
+
+        static constexpr std::array<LineFactory, FAST_PATH_SLOTS.size()> DISPATCH_TABLE =
+            MakeDispatchTable(std::make_index_sequence<FAST_PATH_SLOTS.size()>());
+
+        if (noOfPairs == noOfSlots){
+            for (std::size_t i = 0; i < FAST_PATH_SLOTS.size(); ++i){
+                if (FAST_PATH_SLOTS[i] == noOfSlots)
+                    return DISPATCH_TABLE[i](seed, feedProbabilities, noOfSlots, noOfPairs);
+            }
+        }
+        return MakeLineAt<FAST_PATH_SLOTS.size()>(seed, feedProbabilities, noOfSlots, noOfPairs);
+    }
+
+    Line m_Line;
+};
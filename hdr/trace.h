@@ -0,0 +1,212 @@
+#pragma once
+
+/*
+ * Binary event tracing for the tick loop. Configure with -DRUN_TRACE=ON to compile it in;
+ * otherwise TRACE(...) expands to nothing and none of this exists.
+ * Every thread appends fixed size records to its own single producer/single consumer ring,
+ * a background writer drains all rings to a file. The hot path never locks, never does I/O
+ * and drops (and counts) records rather than wait when its ring is full.
+*/
+
+#include <cstdint>
+
+enum TRACE_EVENT : std::uint8_t {
+
+    TRACE_FEED = 0,     // slot fed, data = slot bits
+    TRACE_SKIP = 1,     // slot already updated this tick
+    TRACE_COMMIT = 2,   // worker's update written to the belt, data = slot bits
+    TRACE_ROLLBACK = 3, // worker lost the slot to its partner
+    TRACE_EXIT = 4      // worker thread leaving
+};
+
+// station and slot keep their low 32 bits on belts of 2^31 pairs or more
+struct TraceRecord {
+    std::uint64_t tick;
+    std::uint32_t worker;   // station, the feed is recorded as station getNoOfWorkers()
+    std::uint32_t slot;
+    std::uint8_t event;
+    std::uint8_t data;
+    std::uint8_t reserved[6];
+};
+static_assert(sizeof(TraceRecord) == 24, "records are written to disk as is");
+
+#ifdef RUN_TRACE
+
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TraceRing {
+
+public:
+    static constexpr std::size_t CAPACITY = 1 << 14;
+
+    // producer side
+    inline void Push(const TraceRecord& record) noexcept{
+
+        const std::size_t head = m_Head.load(std::memory_order_relaxed);
+        if (head - m_Tail.load(std::memory_order_acquire) == CAPACITY){
+            m_Dropped.store(m_Dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        m_Records[head & (CAPACITY - 1)] = record;
+        m_Head.store(head + 1, std::memory_order_release);
+    }
+
+    // consumer side
+    template<class Sink>
+    std::size_t Drain(Sink&& sink){
+
+        const std::size_t tail = m_Tail.load(std::memory_order_relaxed);
+        const std::size_t head = m_Head.load(std::memory_order_acquire);
+        for (std::size_t i = tail; i != head; ++i){
+            sink(m_Records[i & (CAPACITY - 1)]);
+        }
+        m_Tail.store(head, std::memory_order_release);
+        return head - tail;
+    }
+
+    bool IsEmpty() const noexcept{
+        return m_Head.load(std::memory_order_acquire) == m_Tail.load(std::memory_order_relaxed);
+    }
+
+    std::size_t getDropped() const noexcept { return m_Dropped.load(std::memory_order_relaxed); }
+
+    // cleared when the owning thread exits so the ring can be handed to a new thread once drained
+    std::atomic_bool m_Owned{true};
+
+private:
+    alignas(64) std::atomic<std::size_t> m_Head{0};
+    alignas(64) std::atomic<std::size_t> m_Tail{0};
+    std::atomic<std::size_t> m_Dropped{0};
+    std::array<TraceRecord, CAPACITY> m_Records;
+};
+
+class Tracer {
+
+public:
+    static Tracer& Instance(){
+        static Tracer tracer;
+        return tracer;
+    }
+
+    // Opens path and starts the background writer. Records are only kept between Start and Stop.
+    void Start(const std::string& path){
+
+        Stop();
+        m_File.open(path, std::ios::binary | std::ios::trunc);
+        if (!m_File)
+            throw std::runtime_error("Tracer: cannot open " + path);
+        m_Running.store(true, std::memory_order_relaxed);
+        m_Writer = std::thread(&Tracer::WriterLoop, this);
+        m_Enabled.store(true, std::memory_order_release);
+    }
+
+    // Drains everything left and closes the file. Returns the number of records dropped.
+    std::size_t Stop(){
+
+        m_Enabled.store(false, std::memory_order_release);
+        if (!m_Writer.joinable())
+            return 0;
+        m_Running.store(false, std::memory_order_relaxed);
+        m_Writer.join();
+        DrainAll();
+        m_File.close();
+
+        std::lock_guard lk(m_Mu);
+        std::size_t dropped = 0;
+        for (const auto& ring : m_Rings)
+            dropped += ring->getDropped();
+        return dropped;
+    }
+
+    // runtime switch, keeps the writer running
+    void Enable(const bool enabled) noexcept{
+        m_Enabled.store(enabled && m_Writer.joinable(), std::memory_order_release);
+    }
+
+    inline void Record(const std::uint64_t tick, const std::size_t worker, const TRACE_EVENT event,
+                       const std::size_t slot, const std::uint8_t data = 0) noexcept{
+
+        if (!m_Enabled.load(std::memory_order_relaxed))
+            return;
+        Ring().Push(TraceRecord{tick, static_cast<std::uint32_t>(worker), static_cast<std::uint32_t>(slot), event, data, {}});
+    }
+
+    ~Tracer(){
+        Stop();
+    }
+
+private:
+    Tracer() = default;
+
+    struct RingHandle {
+        TraceRing* ring{nullptr};
+        ~RingHandle(){
+            if (ring)
+                ring->m_Owned.store(false, std::memory_order_release);
+        }
+    };
+
+    TraceRing& Ring(){
+
+        thread_local RingHandle handle;
+        if (!handle.ring)[[unlikely]]
+            handle.ring = Acquire();
+        return *handle.ring;
+    }
+
+    // first record of a thread: reuse a drained ring of a finished thread or make a new one
+    TraceRing* Acquire(){
+
+        std::lock_guard lk(m_Mu);
+        for (const auto& ring : m_Rings){
+            if (!ring->m_Owned.load(std::memory_order_acquire) && ring->IsEmpty()){
+                ring->m_Owned.store(true, std::memory_order_relaxed);
+                return ring.get();
+            }
+        }
+        m_Rings.push_back(std::make_unique<TraceRing>());
+        return m_Rings.back().get();
+    }
+
+    void WriterLoop(){
+
+        while (m_Running.load(std::memory_order_relaxed)){
+            if (DrainAll() == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    std::size_t DrainAll(){
+
+        std::lock_guard lk(m_Mu);
+        std::size_t drained = 0;
+        for (const auto& ring : m_Rings){
+            drained += ring->Drain([this](const TraceRecord& record){
+                m_File.write(reinterpret_cast<const char*>(&record), sizeof(record));
+            });
+        }
+        return drained;
+    }
+
+    std::atomic_bool m_Enabled{false};
+    std::atomic_bool m_Running{false};
+    std::mutex m_Mu;
+    std::vector<std::unique_ptr<TraceRing>> m_Rings;
+    std::ofstream m_File;
+    std::thread m_Writer;
+};
+
+#define TRACE(...) Tracer::Instance().Record(__VA_ARGS__)
+
+#else
+
+#define TRACE(...) ((void)0)
+
+#endif
@@ -1,139 +1,258 @@
 #pragma once
 
-class Production;
+template<std::size_t NO_OF_SLOTS>
+class ProductionLine;
+
+enum STATE : std::uint8_t {
+
+    STATE_FETCH = 0,
+    STATE_GET_B_OR_C = 1,
+    STATE_GET_A = 2,
+    STATE_DECODE = 3,
+    STATE_FULL = 4
+};
+
+// std::array for a fixed number of stations, std::vector for DYNAMIC_SLOTS
+template<class T, std::size_t N>
+using StationArray = std::conditional_t<N == DYNAMIC_SLOTS, std::vector<T>, std::array<T, N>>;
+
+/*
+ * Flat store of every worker's state, one entry per station (2 * pair + side). Engines walk it
+ * linearly instead of chasing a pointer per worker and another per state chart.
+ * Threads of the threaded engine write neighbouring bytes here, which costs some false sharing,
+ * but that engine is bound by its tick barrier anyway.
+*/
+template<std::size_t NO_OF_WORKERS>
+struct WorkerStore {
+
+    explicit WorkerStore(const std::size_t noOfWorkers = NO_OF_WORKERS){
+
+        if constexpr (NO_OF_WORKERS == DYNAMIC_SLOTS){
+            currState.resize(noOfWorkers);
+            prevState.resize(noOfWorkers);
+            timeout.resize(noOfWorkers);
+            componentInHand.resize(noOfWorkers);
+        }
+    }
+
+    StationArray<STATE, NO_OF_WORKERS> currState{};
+    StationArray<STATE, NO_OF_WORKERS> prevState{};
+    StationArray<std::uint8_t, NO_OF_WORKERS> timeout{};
+    StationArray<COMPONENT, NO_OF_WORKERS> componentInHand{};
+
+    static constexpr std::size_t BYTES_PER_WORKER = sizeof(STATE) * 2 + sizeof(std::uint8_t) + sizeof(COMPONENT);
+    // every array holds a byte per station, so this many stations write each cache line of it
+    static constexpr std::size_t STATIONS_PER_LINE = 64;
+    static_assert(sizeof(STATE) == 1 && sizeof(COMPONENT) == 1, "STATIONS_PER_LINE counts one byte entries");
+};
+
+/*
+ * How the optimistic slot protocol went for one worker. A line of its own per worker so counting
+ * never contends; every lost claim is rolled back, the sequential engine never rolls back.
+*/
+struct alignas(64) WorkerStats {
+
+    std::uint64_t skippedUpdated{0};    // slot already updated this tick, nothing processed
+    std::uint64_t claimFailures{0};     // compare-exchange lost, the slot was written since it was loaded
+    std::uint64_t rollbacks{0};
+    std::uint64_t commits{0};
+    std::uint64_t cyclesWasted{0};      // from Process to the end of Rollback, see ReadCycleCounter
+    ContextSwitches contextSwitches;    // of the worker's thread during the last Start, threaded engine only
+
+    void Merge(const WorkerStats& other) noexcept{
+        skippedUpdated += other.skippedUpdated;
+        claimFailures += other.claimFailures;
+        rollbacks += other.rollbacks;
+        commits += other.commits;
+        cyclesWasted += other.cyclesWasted;
+        contextSwitches += other.contextSwitches;
+    }
+};
+
+// time stamp counter where there is one, nanoseconds elsewhere
+inline std::uint64_t ReadCycleCounter() noexcept{
+
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/*
+ * Reference StateChart step, written branch by branch from the work flow rules. It is only
+ * evaluated at compile time to fill TRANSITION_TABLE and by the unit tests.
+*/
+constexpr void ReferenceTransition(STATE& currState, std::uint8_t& timeout, COMPONENT& componentInHand, SlotData& slot) noexcept{
+
+    if (timeout > 0)[[likely]]
+        --timeout;
+
+    switch (currState){
+    case STATE_FETCH:
+        if (slot.testComponent<COMPONENT::COMPONENT_A>()){
+            currState = STATE_GET_B_OR_C;
+            slot.SetUpdated();
+            slot.ClearComponent<COMPONENT::COMPONENT_A>();
+        }else if (slot.testComponent<COMPONENT::COMPONENT_B>() || slot.testComponent<COMPONENT::COMPONENT_C>()){
+            currState = STATE_GET_A;
+            slot.ClearComponent<COMPONENT::COMPONENT_B>();
+            slot.ClearComponent<COMPONENT::COMPONENT_C>();
+            slot.SetUpdated();
+        }
+        break;
+    case STATE_GET_B_OR_C:
+        if (slot.testComponent<COMPONENT::COMPONENT_B>() || slot.testComponent<COMPONENT::COMPONENT_C>()){
+            timeout = 4;
+            currState = STATE_DECODE;
+            slot.ClearComponent<COMPONENT::COMPONENT_B>();
+            slot.ClearComponent<COMPONENT::COMPONENT_C>();
+            slot.SetUpdated();
+        }
+        break;
+    case STATE_GET_A:
+        if (slot.testComponent<COMPONENT::COMPONENT_A>()){
+            timeout = 4;
+            currState = STATE_DECODE;
+            slot.ClearComponent<COMPONENT::COMPONENT_A>();
+            slot.SetUpdated();
+        }
+        break;
+    case STATE_DECODE:
+        if (slot.testIsEmpty() && timeout == 0){
+            currState = STATE_FETCH;
+            slot.SetComponent<COMPONENT::COMPONENT_P>();
+        }else if (timeout == 0 && slot.AnyComponent()){
+            if (slot.testComponent<COMPONENT::COMPONENT_A>()){
+                currState = STATE_FULL;
+                slot.ClearComponent<COMPONENT::COMPONENT_A>();
+                componentInHand = COMPONENT::COMPONENT_A;
+            }
+            if (slot.testComponent<COMPONENT::COMPONENT_B>() || slot.testComponent<COMPONENT::COMPONENT_C>()){
+                currState = STATE_FULL;
+                slot.ClearComponent<COMPONENT::COMPONENT_B>();
+                slot.ClearComponent<COMPONENT::COMPONENT_C>();
+                componentInHand = COMPONENT::COMPONENT_B;
+            }
+        }
+        break;
+    case STATE_FULL:
+        if (slot.testIsEmpty()){
+            slot.SetComponent<COMPONENT::COMPONENT_P>();
+            slot.SetUpdated();
+
+            if (componentInHand == COMPONENT::COMPONENT_A){
+                currState = STATE_GET_B_OR_C;
+            }else if (componentInHand == COMPONENT::COMPONENT_B ||
+                      componentInHand == COMPONENT::COMPONENT_C){
+                currState = STATE_GET_A;
+            }else{
+                currState = STATE_FETCH;
+            }
+        }
+        break;
+    }
+}
+
+/*
+ * The step above only depends on (state, timeout hits 0, component bits of the slot, component in hand),
+ * 5 * 2 * 32 * 4 inputs. Each entry gives the next state, the new component bits plus isUpdated, the
+ * new hand, and whether the timeout is reloaded instead of counted down.
+*/
+struct Transition {
+    STATE nextState;
+    std::uint8_t slotBits;
+    COMPONENT componentInHand;
+    bool reloadTimeout;
+};
+
+constexpr std::size_t TransitionIndex(const STATE state, const bool timedOut, const std::uint8_t slotBits, const COMPONENT componentInHand) noexcept{
+    return ((static_cast<std::size_t>(state) * 2 + timedOut) * 32 + (slotBits & SlotData::COMPONENT_MASK)) * 4 + (componentInHand & 3);
+}
+
+constexpr std::array<Transition, 5 * 2 * 32 * 4> MakeTransitionTable() noexcept{
+
+    std::array<Transition, 5 * 2 * 32 * 4> table{};
+    for (std::uint8_t state = STATE_FETCH; state <= STATE_FULL; ++state){
+        for (std::uint8_t timedOut = 0; timedOut < 2; ++timedOut){
+            for (std::uint8_t bits = 0; bits < 32; ++bits){
+                for (std::uint8_t hand = 0; hand < 4; ++hand){
+                    STATE nextState = static_cast<STATE>(state);
+                    // 1 counts down to 0, 2 stays above it
+                    std::uint8_t timeout = timedOut ? 1 : 2;
+                    COMPONENT componentInHand = static_cast<COMPONENT>(hand);
+                    SlotData slot{bits};
+                    ReferenceTransition(nextState, timeout, componentInHand, slot);
+
+                    table[TransitionIndex(static_cast<STATE>(state), timedOut, bits, static_cast<COMPONENT>(hand))] =
+                        Transition{nextState, slot.bits, componentInHand, timeout == 4};
+                }
+            }
+        }
+    }
+    return table;
+}
+
+inline constexpr auto TRANSITION_TABLE = MakeTransitionTable();
 
 /*
  * State chart for worker's work flow management
  * transaction based model. if worker is quick enough to act on the slot than its partner
  * transaction will commit if not rollback. Since every worker is a thread no penalty in
  * perform work and rollback if not needed.
+ * A StateChart is just a view on one station of the WorkerStore, cheap to make on the fly.
 */
-template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
-template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
+template<std::size_t NO_OF_WORKERS>
 class StateChart {
 
-    struct StateFetch { };
-    struct StateGetBOrC { };
-    struct StateGetA { };
-    struct StateDecode { };
-    struct StateFull { };
-
 public:
+    StateChart(WorkerStore<NO_OF_WORKERS>& store, const std::size_t station)
+        :m_Store(store),
+         m_Station(station)
+    {}
+
+    // One table lookup, see TRANSITION_TABLE.
     void Process(SlotData& slot) noexcept{
 
-        static std::string classnames[] = {"StateFetch", "StateGetBOrC", "StateGetA", "StateDecode", "StateFull"};
-
-        m_PrevState = m_CurrState;
-
-        //std::cout << "m_PrevState: " << classnames[m_PrevState.index()] << std::endl;
-
-        if (m_Timeout > 0)[[likely]]
-            --m_Timeout;
-
-        std::visit(overloaded {
-                       [&slot, this](const StateFetch& arg) {
-
-                           if (slot.testComponent<COMPONENT::COMPONENT_A>()){
-                               m_CurrState = StateGetBOrC{};
-                               slot.isUpdated = true;
-                               slot.ClearComponent<COMPONENT::COMPONENT_A>();
-                           }else if (slot.testComponent<COMPONENT::COMPONENT_B>() || slot.testComponent<COMPONENT::COMPONENT_C>()){
-                               m_CurrState = StateGetA{};
-                               slot.ClearComponent<COMPONENT::COMPONENT_B>();
-                               slot.ClearComponent<COMPONENT::COMPONENT_C>();
-                               slot.isUpdated = true;
-                           }
-                       },
-                       [&slot, this](const StateGetBOrC& arg) {
-
-                           if (slot.testComponent<COMPONENT::COMPONENT_B>() || slot.testComponent<COMPONENT::COMPONENT_C>()){
-                               m_Timeout = 4;
-                               m_CurrState = StateDecode{};
-                               slot.ClearComponent<COMPONENT::COMPONENT_B>();
-                               slot.ClearComponent<COMPONENT::COMPONENT_C>();
-                               slot.isUpdated = true;
-                           }
-                       },
-                       [&slot, this](const StateGetA& arg) {
-                           if (slot.testComponent<COMPONENT::COMPONENT_A>()){
-                               m_Timeout = 4;
-                               m_CurrState = StateDecode{};
-                               slot.ClearComponent<COMPONENT::COMPONENT_A>();
-                               slot.isUpdated = true;
-                           }
-                       },
-                       [&slot, this](const StateDecode& arg) {
-                           if (slot.testIsEmpty() && m_Timeout == 0){
-                               m_CurrState = StateFetch{};
-                               slot.SetComponent<COMPONENT::COMPONENT_P>();
-                           }else if (m_Timeout == 0 && slot.AnyComponent()){
-                               if (slot.testComponent<COMPONENT::COMPONENT_A>()){
-                                   m_CurrState = StateFull{};
-                                   slot.ClearComponent<COMPONENT::COMPONENT_A>();
-                                   m_ComponentInHand = COMPONENT::COMPONENT_A;
-                               }
-                               if (slot.testComponent<COMPONENT::COMPONENT_B>() || slot.testComponent<COMPONENT::COMPONENT_C>()){
-                                   m_CurrState = StateFull{};
-                                   slot.ClearComponent<COMPONENT::COMPONENT_B>();
-                                   slot.ClearComponent<COMPONENT::COMPONENT_C>();
-                                   m_ComponentInHand = COMPONENT::COMPONENT_B;
-                               }
-                           }
-                       },
-                       [&slot, this](const StateFull& arg) {
-                           if (slot.testIsEmpty()){
-                               slot.SetComponent<COMPONENT::COMPONENT_P>();
-                               slot.isUpdated = true;
-
-                               if (m_ComponentInHand == COMPONENT::COMPONENT_A){
-                                   m_CurrState = StateGetBOrC{};
-                               }else if (m_ComponentInHand == COMPONENT::COMPONENT_B ||
-                                         m_ComponentInHand == COMPONENT::COMPONENT_C){
-                                   m_CurrState = StateGetA{};
-                               }else{
-                                   m_CurrState = StateFetch{};
-                               }
-                           }
-                       },
-                       [](auto) { }
-                   }, m_CurrState);
-
-        //::cout << "m_CurrState: " << classnames[m_CurrState.index()] << std::endl;
+        STATE& currState = m_Store.currState[m_Station];
+        std::uint8_t& timeout = m_Store.timeout[m_Station];
+        COMPONENT& componentInHand = m_Store.componentInHand[m_Station];
+
+        const Transition& t = TRANSITION_TABLE[TransitionIndex(currState, timeout <= 1, slot.bits, componentInHand)];
+
+        m_Store.prevState[m_Station] = currState;
+        currState = t.nextState;
+        componentInHand = t.componentInHand;
+        timeout = t.reloadTimeout ? 4 : timeout - (timeout > 0);
+        slot.bits = (slot.bits & ~SlotData::COMPONENT_MASK) | t.slotBits;
     }
 
     inline void Commit(){
-        m_CurrState = m_CurrState;
     }
 
     inline void Rollback(){
-        m_CurrState = m_PrevState;
+        m_Store.currState[m_Station] = m_Store.prevState[m_Station];
     }
 
-    bool getIsWorkersWithUnfinishedProducts() noexcept{
-        bool ret = false;
-        std::visit([&ret, this](auto&& arg) {
-            using T = std::decay_t<decltype(arg)>;
-            if constexpr (std::is_same_v<T, StateGetBOrC> || std::is_same_v<T, StateGetA>)
-               ret = true;
-            else if constexpr (std::is_same_v<T, StateDecode> || std::is_same_v<T, StateFull>)
-               ret = m_ComponentInHand != 0 ? true : false;
-        }, m_CurrState);
-
-        return ret;
+    bool getIsWorkersWithUnfinishedProducts() const noexcept{
+
+        switch (m_Store.currState[m_Station]){
+        case STATE_GET_B_OR_C:
+        case STATE_GET_A:
+            return true;
+        case STATE_DECODE:
+        case STATE_FULL:
+            return m_Store.componentInHand[m_Station] != 0;
+        default:
+            return false;
+        }
     }
 
 private:
-    COMPONENT m_ComponentInHand{COMPONENT::EMPTY};
-    std::uint8_t m_Timeout{0};
-    std::variant<StateFetch, StateGetBOrC, StateGetA, StateDecode, StateFull> m_PrevState = StateFetch{};
-    std::variant<StateFetch, StateGetBOrC, StateGetA, StateDecode, StateFull> m_CurrState = StateFetch{};
-
-    GETTER(m_CurrState);
+    WorkerStore<NO_OF_WORKERS>& m_Store;
+    const std::size_t m_Station;
 };
 
-template<std::size_t NO_OF_SLOTS>
-class WorkerPair;
-
 /*
  * SOLID principle. Worker class will take only responsibility of filling up the slot.
  * Rule of 5. not defined compiler generated functions unless required.
@@ -142,87 +261,84 @@ template<std::size_t NO_OF_SLOTS>
 class Worker {
 
 public:
-    Worker(const std::uint8_t initialIndex, Production& prod, WorkerPair<NO_OF_SLOTS>& mngr)
-         :m_Belt(prod.m_Belt),
-          m_LastReadIndex(initialIndex),
-          m_FutureFromProd(std::move(prod.getFuture())),
-          m_PromiseToProd(std::move(prod.getPromise())),
-          m_Mu(prod.m_Mu),
+    Worker(const std::size_t station, ProductionLine<NO_OF_SLOTS>& prod)
+         :m_Station(station),
+          m_Belt(prod.m_Belt),
           m_BeltOwner(prod),
-          m_Manager(mngr),
-          m_WorkFlow(std::make_unique<StateChart>())
+          m_Stats(prod.m_WorkerStats[station]),
+          m_WorkFlow(prod.m_WorkerStates, station)
     {}
 
 
     bool Work(){
 
+        const ContextSwitches switchesBefore = ContextSwitches::OfThisThread();
+        CpuPlacement::ApplyToThisThread("fs-worker-" + std::to_string(m_Station), m_BeltOwner.m_Placement.getPairCpu(m_Station / 2));
+        // the head is read once, no feed can come before this worker's first arrival; after that
+        // the slot moves on by one every tick, just like the head does
+        std::size_t slotIndex = m_BeltOwner.getSlotOfPair(m_Station / 2, m_BeltOwner.m_Head);
+        LATENCY_START(m_BeltOwner.m_Latency[m_Station]);
         while(true){
 
-            // stand-by until Belt is fed and signaled.
-            m_FutureFromProd.get();
-            m_FutureFromProd = std::move(m_BeltOwner.getFuture());
-            {
-                std::shared_lock lk(m_Mu);
-
-                m_LastReadIndex = m_BeltOwner.getSlotIndexAfter(m_LastReadIndex);
-                if (m_LastReadIndex >= NO_OF_SLOTS)
-                    return false;
+            // stand-by until Belt is fed and every worker is released for this tick.
+            m_BeltOwner.m_TickBarrier.ArriveAndWait();
+            LATENCY_LAP(m_BeltOwner.m_Latency[m_Station], PHASE_BARRIER);
+            if (m_BeltOwner.m_Exit.load(std::memory_order_relaxed)){
+                TRACE(m_BeltOwner.m_Tick, m_Station, TRACE_EXIT, slotIndex);
+                m_Stats.contextSwitches += ContextSwitches::OfThisThread() - switchesBefore;
+                return true;
+            }
 
-                //std::cout << "reading in index: " << (int)m_LastReadIndex << std::endl;
+            slotIndex = m_BeltOwner.getSlotAfter(slotIndex);
+
+            // No belt lock: the feed is the barrier's completion step, over before any worker is released.
+            // Ok to copy, s_read is what the claim compares against
+            const SlotData s_read = std::atomic_load_explicit(&m_Belt[slotIndex], std::memory_order_acquire);
+            SlotData s_cur = s_read;
+            if (s_cur.testIsUpdated()){
+                ++m_Stats.skippedUpdated;
+                TRACE(m_BeltOwner.m_Tick, m_Station, TRACE_SKIP, slotIndex);
+                LATENCY_LAP(m_BeltOwner.m_Latency[m_Station], PHASE_PROCESS);
+                continue;
+            }
 
-                // Ok to copy
-                SlotData s_cur = std::atomic_load_explicit(&m_Belt[m_LastReadIndex], std::memory_order_acquire);
-                if (s_cur.isUpdated){
-                    m_PromiseToProd.set_value();
-                    m_PromiseToProd = std::move(m_BeltOwner.getPromise());
+            // Will update data and isUpdated of s_cur.
+            const std::uint64_t processStart = ReadCycleCounter();
+            m_WorkFlow.Process(s_cur);
+            LATENCY_LAP(m_BeltOwner.m_Latency[m_Station], PHASE_PROCESS);
+
+            if (s_cur.testIsUpdated()){
+                // exactly once: claim the slot only if nobody, the partner included, wrote it since s_read.
+                // non-blocking, get ready for rollback if not lucky!!.
+                s_cur.NextGeneration(s_read);
+                SlotData expected = s_read;
+                if (m_Belt[slotIndex].compare_exchange_strong(expected, s_cur, std::memory_order_acq_rel, std::memory_order_acquire)){
+                    m_WorkFlow.Commit();
+                    ++m_Stats.commits;
+                    TRACE(m_BeltOwner.m_Tick, m_Station, TRACE_COMMIT, slotIndex, s_cur.bits);
+                    LATENCY_LAP(m_BeltOwner.m_Latency[m_Station], PHASE_COMMIT);
                     continue;
                 }
-
-                // Will update data and isUpdated of s_cur.
-                m_WorkFlow->Process(s_cur);
-
-                if (s_cur.isUpdated){
-                    // finish the work and check if can update. exactly once stratergy
-                    const SlotData& s_new = std::atomic_load_explicit(&m_Belt[m_LastReadIndex], std::memory_order_acquire);
-                    if (!s_new.isUpdated){
-                        // try lock is non-blocking. get ready for rollback if not lucky!!.
-                        if (m_Manager.TryLock()){
-                            std::atomic_store_explicit(&m_Belt[m_LastReadIndex], s_cur, std::memory_order_release);
-                            m_WorkFlow->Commit();
-                            m_Manager.UnLock();
-                            m_PromiseToProd.set_value();
-                            m_PromiseToProd = std::move(m_BeltOwner.getPromise());
-                            continue;
-                        }
-                    }
-
-                    // must have followed RAII style but to keep simple.
-                    m_WorkFlow->Rollback();
-                }
-                m_PromiseToProd.set_value();
-                if (m_BeltOwner.m_Exit.load(std::memory_order_relaxed)){
-                    return true;
-                }
-                m_PromiseToProd = std::move(m_BeltOwner.getPromise());
+                ++m_Stats.claimFailures;
+
+                // must have followed RAII style but to keep simple.
+                m_WorkFlow.Rollback();
+                ++m_Stats.rollbacks;
+                m_Stats.cyclesWasted += ReadCycleCounter() - processStart;
+                TRACE(m_BeltOwner.m_Tick, m_Station, TRACE_ROLLBACK, slotIndex);
+                LATENCY_LAP(m_BeltOwner.m_Latency[m_Station], PHASE_COMMIT);
             }
         }
 
-        m_PromiseToProd.set_value();
         return true;
     }
 
-    bool getIsWorkersWithUnfinishedProducts(){
-        return m_WorkFlow->getIsWorkersWithUnfinishedProducts();
-    }
 private:
+    const std::size_t m_Station;
     ConveyorBelt<std::atomic<SlotData>, NO_OF_SLOTS>& m_Belt;
-    std::uint8_t m_LastReadIndex;
-    std::shared_mutex& m_Mu;
-    std::future<void> m_FutureFromProd;
-    std::promise<void> m_PromiseToProd;
-    Production& m_BeltOwner;
-    WorkerPair<NO_OF_SLOTS>& m_Manager;
-    std::unique_ptr<StateChart> m_WorkFlow;
+    ProductionLine<NO_OF_SLOTS>& m_BeltOwner;
+    WorkerStats& m_Stats;
+    StateChart<2 * NO_OF_SLOTS> m_WorkFlow;
 };
 
 template<std::size_t NO_OF_SLOTS>
@@ -230,36 +346,26 @@ class WorkerPair {
 public:
 
     WorkerPair() = delete;
-    WorkerPair(const std::uint8_t initialIndex, Production& prod){
-
-        for (int i = 0; i < 2; ++i)
-            m_Workers.emplace_back(std::make_unique<Worker<NO_OF_SLOTS>>(initialIndex, prod, *this));
-    }
+    WorkerPair(const std::size_t pair, ProductionLine<NO_OF_SLOTS>& prod)
+        :m_Workers{Worker<NO_OF_SLOTS>(2 * pair, prod),
+                   Worker<NO_OF_SLOTS>(2 * pair + 1, prod)}
+    {}
 
     void Start() {
         for (int i = 0; i < 2; ++i){
-            auto fu = std::async(std::launch::async, &Worker<NO_OF_SLOTS>::Work, m_Workers[i].get());
+            auto fu = std::async(std::launch::async, &Worker<NO_OF_SLOTS>::Work, &m_Workers[i]);
             m_Futures.push_back(std::move(fu));
         }
     }
 
-    inline bool TryLock(){
-        return m_Mu.try_lock();
-    }
-
-    inline void UnLock(){
-        m_Mu.unlock();
-        m_CondVar.notify_one();
-    }
-
-    std::size_t getNoOfWorkersWithUnfinishedProducts(){
-        return ((int)m_Workers[0]->getIsWorkersWithUnfinishedProducts() +
-                (int)m_Workers[1]->getIsWorkersWithUnfinishedProducts());
+    void Join() {
+        while (!m_Futures.empty()){
+            m_Futures.front().get();
+            m_Futures.pop_front();
+        }
     }
 
 private:
-    std::vector<std::unique_ptr<Worker<NO_OF_SLOTS>>> m_Workers;
-    std::mutex m_Mu;
-    std::condition_variable m_CondVar;
+    std::array<Worker<NO_OF_SLOTS>, 2> m_Workers;
     std::deque<std::future<bool>> m_Futures;
 };
@@ -0,0 +1,257 @@
+#include <benchmark/benchmark.h>
+
+#include "../hdr/production.h"
+#include "../hdr/montecarlo.h"
+
+/*
+ * Whole engine throughput. Every benchmark reports
+ *   ticks/s          ticks of one factory per second
+ *   slot_tick_time   time per slot per tick (printed in ns)
+ *   bytes_per_slot   state touched per slot of one factory
+ * and the threaded engine also
+ *   ctx_switches     context switches of all its threads per tick
+ * Run with --benchmark_out=<file> --benchmark_out_format=json, or build the bench-json target,
+ * to keep results for tracking.
+*/
+namespace {
+
+constexpr std::size_t RUN_TIME = 1000;
+// every threaded tick is a barrier round trip of 2 * pairs + 1 threads
+constexpr std::size_t THREADED_RUN_TIME = 100;
+// long belts run fewer ticks, RUN_TIME ticks' worth of slots on a belt of 16k, but a few temporal blocks at least
+constexpr std::size_t RUN_SLOT_TICKS = RUN_TIME << 14;
+constexpr std::size_t MIN_RUN_TIME = 128;
+
+std::size_t RunTimeFor(const std::size_t noOfSlots)
+{
+    return std::clamp(RUN_SLOT_TICKS / noOfSlots, MIN_RUN_TIME, RUN_TIME);
+}
+
+void SetThroughput(benchmark::State& state, const std::size_t ticks, const std::size_t slotsPerTick, const double bytesPerSlot)
+{
+    state.counters["ticks/s"] = benchmark::Counter(static_cast<double>(ticks), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["slot_tick_time"] = benchmark::Counter(static_cast<double>(ticks * slotsPerTick),
+                                                          benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    state.counters["bytes_per_slot"] = bytesPerSlot;
+}
+
+const char* WaitPolicyName(const WAIT_POLICY policy)
+{
+    switch (policy){
+    case WAIT_POLICY::SPIN_WAIT: return "spin";
+    case WAIT_POLICY::SPIN_PARK_WAIT: return "spin_park";
+    case WAIT_POLICY::PARK_WAIT: return "park";
+    }
+    return "";
+}
+
+// args: engine, belt length, worker pairs, wait policy
+void BM_Production(benchmark::State& state)
+{
+    const ENGINE engine = static_cast<ENGINE>(state.range(0));
+    const std::size_t noOfSlots = state.range(1);
+    const std::size_t noOfPairs = state.range(2);
+    const WAIT_POLICY policy = static_cast<WAIT_POLICY>(state.range(3));
+    const std::size_t runTime = engine == ENGINE::THREADED_ENGINE ? THREADED_RUN_TIME : RUN_TIME;
+
+    std::uint64_t seed = 1;
+    double bytesPerSlot = 0.0;
+    bool isFastPath = false;
+    std::uint64_t contextSwitches = 0;
+    for (auto _ : state){
+        state.PauseTiming();
+        Production p(seed++, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots, noOfPairs);
+        p.SetWaitPolicy(policy);
+        bytesPerSlot = p.getBytesPerSlot();
+        isFastPath = p.getIsFastPath();
+        state.ResumeTiming();
+
+        p.Start(runTime, engine);
+        benchmark::DoNotOptimize(p.getm_noOfProductsFormed());
+        const ContextSwitches switches = p.getContextSwitches();
+        contextSwitches += switches.voluntary + switches.involuntary;
+    }
+
+    state.SetLabel((engine == ENGINE::THREADED_ENGINE ? std::string("threaded/cas/") + WaitPolicyName(policy)
+                                                      : std::string("sequential/none")) +
+                   (isFastPath ? "" : "/dynamic"));
+    SetThroughput(state, runTime, noOfSlots, bytesPerSlot);
+    if (engine == ENGINE::THREADED_ENGINE)
+        state.counters["ctx_switches"] = static_cast<double>(contextSwitches) / (state.iterations() * runTime);
+}
+
+void ProductionArgs(benchmark::internal::Benchmark* b)
+{
+    constexpr int SPIN_PARK = static_cast<int>(WAIT_POLICY::SPIN_PARK_WAIT);
+    for (const ENGINE engine : {ENGINE::SEQUENTIAL_ENGINE, ENGINE::THREADED_ENGINE}){
+        for (const int noOfSlots : {3, 8, 16, 64, 100}){
+            for (const int noOfPairs : {noOfSlots, (noOfSlots + 1) / 2}){
+                b->Args({static_cast<int>(engine), noOfSlots, noOfPairs, SPIN_PARK});
+            }
+        }
+    }
+    // the other wait policies, pure spin only while threads fit the cores
+    for (const int noOfPairs : {3, 16}){
+        for (const WAIT_POLICY policy : {WAIT_POLICY::SPIN_WAIT, WAIT_POLICY::PARK_WAIT}){
+            b->Args({static_cast<int>(ENGINE::THREADED_ENGINE), noOfPairs, noOfPairs, static_cast<int>(policy)});
+        }
+    }
+    b->ArgNames({"engine", "slots", "pairs", "wait"});
+}
+
+// args: belt length, segments, engine. One pair per slot.
+void BM_Partitioned(benchmark::State& state)
+{
+    const std::size_t noOfSlots = state.range(0);
+    const std::size_t noOfSegments = state.range(1);
+    const ENGINE engine = static_cast<ENGINE>(state.range(2));
+
+    std::uint64_t seed = 1;
+    double bytesPerSlot = 0.0;
+    for (auto _ : state){
+        state.PauseTiming();
+        Production p(seed++, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots);
+        p.SetNoOfSegments(noOfSegments);
+        bytesPerSlot = p.getBytesPerSlot();
+        state.ResumeTiming();
+
+        p.Start(RunTimeFor(noOfSlots), engine);
+        benchmark::DoNotOptimize(p.getm_noOfProductsFormed());
+    }
+
+    state.SetLabel(engine == ENGINE::SYSTOLIC_ENGINE ? "systolic/none" : "partitioned/none");
+    SetThroughput(state, RunTimeFor(noOfSlots), noOfSlots, bytesPerSlot);
+}
+
+// weak scaling: the belt grows with the segments, SLOTS_PER_SEGMENT each, up to 2^20 slots
+constexpr int SLOTS_PER_SEGMENT = 1 << 17;
+// strong scaling: one belt cut into more and more segments, a small one and one far past the caches
+constexpr std::array<int, 2> STRONG_SCALING_SLOTS{120, 1 << 20};
+
+void PartitionedWeakArgs(benchmark::internal::Benchmark* b)
+{
+    for (const ENGINE engine : {ENGINE::PARTITIONED_ENGINE, ENGINE::SYSTOLIC_ENGINE}){
+        for (const int noOfSegments : {1, 2, 4, 8}){
+            b->Args({SLOTS_PER_SEGMENT * noOfSegments, noOfSegments, static_cast<int>(engine)});
+        }
+    }
+    b->ArgNames({"slots", "segments", "engine"});
+}
+
+void PartitionedStrongArgs(benchmark::internal::Benchmark* b)
+{
+    for (const int noOfSlots : STRONG_SCALING_SLOTS){
+        for (const ENGINE engine : {ENGINE::PARTITIONED_ENGINE, ENGINE::SYSTOLIC_ENGINE}){
+            for (const int noOfSegments : {1, 2, 4, 8}){
+                b->Args({noOfSlots, noOfSegments, static_cast<int>(engine)});
+            }
+        }
+    }
+    b->ArgNames({"slots", "segments", "engine"});
+}
+
+// args: belt length, ticks per block, slots per tile (0 for the cache sized default). One pair per slot.
+void BM_Temporal(benchmark::State& state)
+{
+    const std::size_t noOfSlots = state.range(0);
+    const std::size_t ticksPerBlock = state.range(1);
+
+    std::uint64_t seed = 1;
+    double bytesPerSlot = 0.0;
+    for (auto _ : state){
+        state.PauseTiming();
+        Production p(seed++, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots);
+        p.SetTemporalBlock(ticksPerBlock, state.range(2));
+        bytesPerSlot = p.getBytesPerSlot();
+        state.ResumeTiming();
+
+        p.Start(RunTimeFor(noOfSlots), ENGINE::TEMPORAL_ENGINE);
+        benchmark::DoNotOptimize(p.getm_noOfProductsFormed());
+    }
+
+    state.SetLabel("temporal/none");
+    SetThroughput(state, RunTimeFor(noOfSlots), noOfSlots, bytesPerSlot);
+}
+
+// one tick per block is the sequential order; 2^14 slots spill L2, 2^20 the last level cache
+void TemporalArgs(benchmark::internal::Benchmark* b)
+{
+    for (const int noOfSlots : {1 << 14, 1 << 20}){
+        for (const int ticksPerBlock : {1, 4, 16, 64}){
+            b->Args({noOfSlots, ticksPerBlock, 0});
+        }
+    }
+    b->ArgNames({"slots", "block", "tile"});
+}
+
+// LANES factories per run, one pair per slot
+template<class W, std::size_t NO_OF_SLOTS>
+void BM_BitSliced(benchmark::State& state)
+{
+    using Sliced = BitSlicedProduction<W, NO_OF_SLOTS>;
+
+    std::uint64_t seed = 1;
+    for (auto _ : state){
+        state.PauseTiming();
+        auto p = std::make_unique<Sliced>(seed++);
+        state.ResumeTiming();
+
+        p->Start(RUN_TIME);
+        benchmark::DoNotOptimize(p->getm_noOfProductsFormed(0));
+    }
+
+    state.SetLabel("bitsliced/none");
+    SetThroughput(state, RUN_TIME * Sliced::LANES, NO_OF_SLOTS, static_cast<double>(sizeof(Sliced)) / (Sliced::LANES * NO_OF_SLOTS));
+}
+
+constexpr int MAX_BATCH_THREADS = 8;
+
+/*
+ * args: batch engine, pool threads. Independent factories on the default belt. The batch is the
+ * same for every thread count and gives each of MAX_BATCH_THREADS threads 4 chunks, a bit-sliced
+ * production or 64 sequential runs each, so the sweep measures scaling rather than one busy thread.
+*/
+void BM_MonteCarlo(benchmark::State& state)
+{
+    const BATCH_ENGINE engine = static_cast<BATCH_ENGINE>(state.range(0));
+    const std::size_t noOfRuns = MAX_BATCH_THREADS * 4 * (engine == BATCH_ENGINE::BITSLICED_BATCH ? BitSlicedProduction<Lanes256>::LANES : 64);
+    const std::size_t runTime = 100;
+
+    MonteCarlo mc(state.range(1));
+    std::uint64_t seed = 1;
+    for (auto _ : state){
+        const BatchResult result = mc.Run(noOfRuns, runTime, seed++, engine);
+        benchmark::DoNotOptimize(result.productsFormed.getMean());
+    }
+
+    using Sliced = BitSlicedProduction<Lanes256>;
+    state.SetLabel(engine == BATCH_ENGINE::BITSLICED_BATCH ? "batch-bitsliced" : "batch-sequential");
+    SetThroughput(state, noOfRuns * runTime, Production::DEFAULT_NO_OF_SLOTS,
+                  engine == BATCH_ENGINE::BITSLICED_BATCH ? static_cast<double>(sizeof(Sliced)) / (Sliced::LANES * Production::DEFAULT_NO_OF_SLOTS)
+                                                          : Production().getBytesPerSlot());
+}
+
+void MonteCarloArgs(benchmark::internal::Benchmark* b)
+{
+    for (const BATCH_ENGINE engine : {BATCH_ENGINE::SEQUENTIAL_BATCH, BATCH_ENGINE::BITSLICED_BATCH}){
+        for (int noOfThreads = 1; noOfThreads <= MAX_BATCH_THREADS; noOfThreads *= 2){
+            b->Args({static_cast<int>(engine), noOfThreads});
+        }
+    }
+    b->ArgNames({"engine", "threads"});
+}
+
+}
+
+BENCHMARK(BM_Production)->Apply(ProductionArgs)->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Partitioned)->Name("BM_PartitionedWeakScaling")->Apply(PartitionedWeakArgs)->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Partitioned)->Name("BM_PartitionedStrongScaling")->Apply(PartitionedStrongArgs)->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Temporal)->Apply(TemporalArgs)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_BitSliced, Lanes64, 3)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_BitSliced, Lanes256, 3)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_BitSliced, Lanes512, 3)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_BitSliced, Lanes256, 16)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_BitSliced, Lanes256, 64)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_MonteCarlo)->Apply(MonteCarloArgs)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -1,30 +1,201 @@
 #include <iostream>
 #include <memory>
+#include <string>
 
 #ifndef RUN_CATCH
 
 #include "../hdr/production.h"
+#include "../hdr/montecarlo.h"
 
+namespace {
+
+void PrintStats(const char* name, const RunningStats& stats)
+{
+    std::cout << name << ": mean " << stats.getMean()
+              << " stddev " << stats.getStdDev()
+              << " 95% CI [" << stats.getMean() - stats.getConfidenceHalfWidth()
+              << ", " << stats.getMean() + stats.getConfidenceHalfWidth() << "]" << std::endl;
+}
+
+WAIT_POLICY ParseWaitPolicy(const std::string& name)
+{
+    if (name == "spin")
+        return WAIT_POLICY::SPIN_WAIT;
+    if (name == "spin-park")
+        return WAIT_POLICY::SPIN_PARK_WAIT;
+    if (name == "park")
+        return WAIT_POLICY::PARK_WAIT;
+    throw std::invalid_argument("unknown wait policy " + name);
+}
+
+int RunBatch(int argc, char *argv[])
+{
+    if (argc < 5){
+        std::cout << "usage: " << argv[0] << " --batch|--batch-bitsliced <runs> <ticks> <seed> [threads]" << std::endl;
+        return 1;
+    }
+
+    const std::size_t noOfRuns = std::stoull(argv[2]);
+    const std::size_t runTime = std::stoull(argv[3]);
+    const std::uint64_t baseSeed = std::stoull(argv[4]);
+    const std::size_t noOfThreads = argc > 5 ? std::stoull(argv[5]) : CpuPlacement::getAvailableConcurrency();
+    const BATCH_ENGINE engine = std::string(argv[1]) == "--batch-bitsliced" ? BATCH_ENGINE::BITSLICED_BATCH : BATCH_ENGINE::SEQUENTIAL_BATCH;
+
+    MonteCarlo mc(noOfThreads);
+    const auto t = std::chrono::steady_clock::now();
+    const BatchResult result = mc.Run(noOfRuns, runTime, baseSeed, engine);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t;
+
+    std::cout << "Runs: " << result.productsFormed.getCount() << " x " << runTime << " ticks on "
+              << mc.getNoOfThreads() << " threads in " << elapsed.count() << " s" << std::endl;
+    PrintStats("Products formed", result.productsFormed);
+    PrintStats("Components left unhandled", result.componentsUnHandled);
+    PrintStats("Empty feeds", result.emptyFeed);
+    PrintStats("Workers owning unfinished products", result.workersWithUnfinishedProducts);
+
+    return 0;
+}
+
+}
+
+/*
+ * factory-simulation [options]          100 ticks on the threaded engine
+ *     --sequential                      on the sequential engine instead
+ *     --partitioned [--segments <n>]    on the partitioned engine instead, n segments (default one per CPU)
+ *     --systolic [--segments <n>]       on the systolic engine instead, same segments
+ *     --temporal [--block <n>] [--tile <n>]
+ *                                       on the time skewed engine instead, n ticks per block (default 8), n slots per tile
+ *     --wait <spin|spin-park|park>      how threads wait on the tick barrier (default spin-park)
+ *     --pin                             pin producer and pairs to CPUs node by node, see CpuPlacement::Compact
+ *     --slots <n> --pairs <n>           belt length (default 3) and worker pairs (default one per slot)
+ *     --ticks <n> --seed <n>            run length (default 100) and feeder seed (default random)
+ *     --trace <file>                    write binary TraceRecords to file (RUN_TRACE builds)
+ * factory-simulation --batch <runs> <ticks> <seed> [threads]
+ *                                       Monte Carlo statistics over many seeded runs
+ * factory-simulation --batch-bitsliced <runs> <ticks> <seed> [threads]
+ *                                       same, 256 runs at a time on the bit-sliced engine
+*/
 int main(int argc, char *argv[])
-{    
-    std::unique_ptr<Production> p = std::make_unique<Production>();
-    const int runTime = 100;
+{
+    const std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "--batch" || mode == "--batch-bitsliced"){
+        try{
+            return RunBatch(argc, argv);
+        }catch(std::exception& ex){
+            std::cout << "ex: " << ex.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // single run options, any order
+    ENGINE engine = ENGINE::THREADED_ENGINE;
+    WAIT_POLICY waitPolicy = WAIT_POLICY::SPIN_PARK_WAIT;
+    bool isPinned = false;
+    std::size_t noOfSegments = 0;
+    std::size_t ticksPerBlock = Production::DEFAULT_TICKS_PER_BLOCK;
+    std::size_t slotsPerTile = 0;
+    std::string tracePath;
+    std::size_t noOfSlots = Production::DEFAULT_NO_OF_SLOTS;
+    std::size_t noOfPairs = 0;
+    std::size_t runTime = 100;
+    std::uint64_t seed = std::random_device{}();
+    std::unique_ptr<Production> p;
+    std::chrono::duration<double> elapsed{0};
     try{
-        p->Start(runTime);
+        for (int i = 1; i < argc; ++i){
+            const std::string arg = argv[i];
+            if (arg == "--sequential")
+                engine = ENGINE::SEQUENTIAL_ENGINE;
+            else if (arg == "--partitioned")
+                engine = ENGINE::PARTITIONED_ENGINE;
+            else if (arg == "--systolic")
+                engine = ENGINE::SYSTOLIC_ENGINE;
+            else if (arg == "--temporal")
+                engine = ENGINE::TEMPORAL_ENGINE;
+            else if (arg == "--block" && i + 1 < argc)
+                ticksPerBlock = std::stoull(argv[++i]);
+            else if (arg == "--tile" && i + 1 < argc)
+                slotsPerTile = std::stoull(argv[++i]);
+            else if (arg == "--segments" && i + 1 < argc)
+                noOfSegments = std::stoull(argv[++i]);
+            else if (arg == "--wait" && i + 1 < argc)
+                waitPolicy = ParseWaitPolicy(argv[++i]);
+            else if (arg == "--pin")
+                isPinned = true;
+            else if (arg == "--trace" && i + 1 < argc)
+                tracePath = argv[++i];
+            else if (arg == "--slots" && i + 1 < argc)
+                noOfSlots = std::stoull(argv[++i]);
+            else if (arg == "--pairs" && i + 1 < argc)
+                noOfPairs = std::stoull(argv[++i]);
+            else if (arg == "--ticks" && i + 1 < argc)
+                runTime = std::stoull(argv[++i]);
+            else if (arg == "--seed" && i + 1 < argc)
+                seed = std::stoull(argv[++i]);
+            else
+                throw std::invalid_argument("unknown option " + arg);
+        }
+
+        p = std::make_unique<Production>(seed, Production::DEFAULT_FEED_PROBABILITIES, noOfSlots, noOfPairs);
+        p->SetWaitPolicy(waitPolicy);
+        p->SetNoOfSegments(noOfSegments);
+        p->SetTemporalBlock(ticksPerBlock, slotsPerTile);
+        if (isPinned)
+            p->SetCompactPlacement();
+        if (!tracePath.empty()){
+#ifdef RUN_TRACE
+            Tracer::Instance().Start(tracePath);
+#else
+            std::cout << "tracing not compiled in, configure with -DRUN_TRACE=ON" << std::endl;
+#endif
+        }
+        const auto t = std::chrono::steady_clock::now();
+        p->Start(runTime, engine);
+        elapsed = std::chrono::steady_clock::now() - t;
     }catch(std::exception& ex){
         std::cout << "ex: " << ex.what() << std::endl;
+        if (!p)
+            return 1;
     }
+#ifdef RUN_TRACE
+    if (!tracePath.empty())
+        std::cout << "Trace records dropped: " << Tracer::Instance().Stop() << std::endl;
+#endif
+
+#ifdef RUN_LATENCY
+    p->getPhaseLatency().Print(std::cout);
+#endif
 
+    std::cout << "Belt: " << p->getNoOfSlots() << " slots, " << p->getNoOfPairs() << " worker pairs"
+              << (p->getIsFastPath() ? "" : " (dynamic)")
+              << (engine == ENGINE::PARTITIONED_ENGINE || engine == ENGINE::SYSTOLIC_ENGINE ? " in " + std::to_string(p->getNoOfSegments()) + " segments" : "")
+              << (engine == ENGINE::TEMPORAL_ENGINE ? " in tiles of " + std::to_string(p->getSlotsPerTile()) + " slots x " +
+                                                      std::to_string(p->getTicksPerBlock()) + " ticks" : "")
+              << ", " << runTime << " ticks in " << elapsed.count() << " s" << std::endl;
     std::cout << "Workers owning unfinished products: " << p->getNoOfWorkersWithUnfinishedProducts() << std::endl;
     std::cout << "No. of empty feeds: " << p->getm_noOfEmptyFeed() << std::endl;
     std::cout << "No. of products formed: " << p->getm_noOfProductsFormed() << std::endl;
     std::cout << "No. of components left unhandled: " << p->getm_noOfComponentsUnHandled() << std::endl;
+    std::cout << "Worker state and stats bytes per worker: " << Production::getBytesPerWorker() << std::endl;
+
+    const WorkerStats stats = p->getContentionStats();
+    std::cout << "Slot commits: " << stats.commits << ", skipped as updated: " << stats.skippedUpdated
+              << ", claims lost and rolled back: " << stats.rollbacks << ", cycles wasted: " << stats.cyclesWasted << std::endl;
+    const ContextSwitches switches = p->getContextSwitches();
+    if (p->getPlacement().getIsPinned()){
+        std::cout << "Pinned: producer on CPU " << p->getPlacement().getProducerCpu() << ", pairs on CPUs";
+        for (std::size_t pair = 0; pair < p->getNoOfPairs(); ++pair)
+            std::cout << " " << p->getPlacement().getPairCpu(pair);
+        std::cout << std::endl;
+    }
+    std::cout << "Context switches: " << switches.voluntary << " voluntary, " << switches.involuntary << " involuntary" << std::endl;
 
     return 0;
 }
 #else
 
 #include "../hdr/production.h"
+#include "../hdr/montecarlo.h"
 #include "../hdr/catch_testcases.h"
 
 #endif
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+/*
+ * Process startup cost: launches a binary many times with its output sent to /dev/null and
+ * reports wall time per launch, spawn to exit.
+ *
+ * startup-bench <runs> <binary> [args...]
+*/
+namespace {
+
+double LaunchOnce(char* argv[])
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    const auto t = std::chrono::steady_clock::now();
+    pid_t pid;
+    const int err = posix_spawn(&pid, argv[0], &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (err != 0)
+        throw std::runtime_error(std::string("cannot launch ") + argv[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - t;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        throw std::runtime_error(std::string(argv[0]) + " failed");
+
+    return elapsed.count();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3){
+        std::cout << "usage: " << argv[0] << " <runs> <binary> [args...]" << std::endl;
+        return 1;
+    }
+
+    try{
+        const std::size_t noOfRuns = std::max<std::size_t>(1, std::stoull(argv[1]));
+        // warm the page cache first
+        LaunchOnce(argv + 2);
+
+        std::vector<double> times;
+        for (std::size_t i = 0; i < noOfRuns; ++i)
+            times.push_back(LaunchOnce(argv + 2));
+        std::sort(times.begin(), times.end());
+
+        double sum = 0.0;
+        for (const double t : times)
+            sum += t;
+        std::cout << argv[2] << ": " << noOfRuns << " launches, mean " << sum / noOfRuns << " us, median "
+                  << times[noOfRuns / 2] << " us, min " << times.front() << " us" << std::endl;
+    }catch(std::exception& ex){
+        std::cout << "ex: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}